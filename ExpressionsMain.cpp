@@ -3,7 +3,11 @@
 //
 
 #include "./binary_expression.h"
+#include "./expression_sources.h"
+#include "./streaming_expression.h"
+#include "./typed_expression.h"
 
+#include <numeric>
 #include <print>
 
 int main() {
@@ -14,4 +18,36 @@ int main() {
     for (const auto& result : binary) {
         std::println("result: {}", std::get<double>(result));
     }
+
+    // A deep tree, once with an intermediate vector per node and once fused
+    // into a single pass over the output.
+    constexpr size_t depth = 6;
+    const size_t n = 4;
+    const size_t numSteps = 2;
+    auto print = [](std::string_view name, const Arg& arg) {
+        std::print("{}:", name);
+        for (double val : std::get<std::vector<double>>(arg)) {
+            std::print(" {}", val);
+        }
+        std::println("");
+    };
+    for (const auto& [unfused, fused] : std::views::zip(unfusedTree<depth>(n, numSteps),
+                                                        fused::evaluate(fusedTree<depth>(n, numSteps)))) {
+        print("unfused", unfused);
+        print("fused  ", fused);
+    }
+
+    // Typed columns keep their element type, comparisons give a bitmask.
+    std::vector<int32_t> ints(100);
+    std::iota(ints.begin(), ints.end(), 0);
+    auto sum = typed::evaluateBinaryExpression(typed::Arg{ints}, typed::Arg{0.5f}, std::plus<>{});
+    auto mask = typed::evaluateBinaryExpression(sum, typed::Arg{42}, std::less<>{});
+    std::println("float sum: {}, below 42: {}", std::holds_alternative<std::vector<float>>(sum),
+                 std::get<typed::Bitmask>(mask).count());
+
+    // A column that would not fit into memory, streamed in chunks.
+    const size_t hugeSize = 1'000'000'000;
+    auto huge = streaming::binaryExpression(streaming::generate(hugeSize, [](size_t i) { return static_cast<double>(i % 7); }),
+                                            streaming::scalar(0.5), std::multiplies{});
+    std::println("streamed sum: {}", streaming::sum(std::move(huge)));
 }
@@ -23,4 +23,15 @@ std::unique_ptr<Base> makeVirtualIota() {
 
 int indirectFunction() {
   return 42;
-}
\ No newline at end of file
+}
+
+batched::any_generator<size_t> makeAnyIota(int source) {
+  switch (source) {
+    case 0:
+      return batched::any_generator<size_t>{std::views::iota(size_t{0})};
+    case 1:
+      return batched::any_generator<size_t>{iota_gen_simple()};
+    default:
+      return batched::any_generator<size_t>{iota_gen_batched()};
+  }
+}
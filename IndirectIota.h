@@ -11,6 +11,7 @@
 
 #include "./simple_generator.h"
 #include "./batched_generator.h"
+#include "./any_generator.h"
 
 template <typename F>
 using R = std::remove_reference_t<std::invoke_result_t<F, size_t>>;
@@ -33,6 +34,39 @@ custom::generator<R<F>> iota_gen_simple(F f = {}) {
     }
 }
 
+template <typename Alloc, typename F = std::identity>
+custom::generator<R<F>, void, Alloc> iota_gen_simple(std::allocator_arg_t, const Alloc&, F f = {}) {
+    size_t i = 0;
+    while (true) {
+        co_yield f(i++);
+    }
+}
+
+// `iota_gen_simple` nested `depth` levels deep via `elements_of`, every level
+// forwards to the innermost one.
+template <typename F = std::identity>
+custom::generator<R<F>> iota_gen_nested(size_t depth, F f = {}) {
+    if (depth == 0) {
+        co_yield std::ranges::elements_of(iota_gen_simple(f));
+    } else {
+        co_yield std::ranges::elements_of(iota_gen_nested(depth - 1, f));
+    }
+}
+
+// The same nesting, but every level re-yields the values of the level below.
+template <typename F = std::identity>
+custom::generator<R<F>> iota_gen_reyield(size_t depth, F f = {}) {
+    if (depth == 0) {
+        for (auto&& el : iota_gen_simple(f)) {
+            co_yield std::move(el);
+        }
+    } else {
+        for (auto&& el : iota_gen_reyield(depth - 1, f)) {
+            co_yield std::move(el);
+        }
+    }
+}
+
 template <typename F = std::identity>
 batched::generator<R<F>> iota_gen_batched(F f = {}) {
     size_t i = 0;
@@ -41,6 +75,40 @@ batched::generator<R<F>> iota_gen_batched(F f = {}) {
     }
 }
 
+// `iota_gen_simple` and `iota_gen_batched` that finish after `n` elements.
+template <typename F = std::identity>
+custom::generator<R<F>> iota_gen_simple_n(size_t n, F f = {}) {
+    for (size_t i = 0; i < n; ++i) {
+        co_yield f(i);
+    }
+}
+
+template <typename F = std::identity>
+batched::generator<R<F>> iota_gen_batched_n(size_t n, F f = {}) {
+    for (size_t i = 0; i < n; ++i) {
+        co_yield f(i);
+    }
+}
+
+// `iota_gen_simple` and `iota_gen_batched` that finish after `request_stop()`.
+template <typename F = std::identity>
+custom::generator<R<F>> iota_gen_stoppable(F f = {}) {
+    auto stop = co_await custom::get_stop_token;
+    size_t i = 0;
+    while (!stop.stop_requested()) {
+        co_yield f(i++);
+    }
+}
+
+template <typename F = std::identity>
+batched::generator<R<F>> iota_gen_batched_stoppable(F f = {}) {
+    auto stop = co_await batched::get_stop_token;
+    size_t i = 0;
+    while (!stop.stop_requested()) {
+        co_yield f(i++);
+    }
+}
+
 template <typename F = std::identity>
 std::generator<std::vector<R<F>>&> iota_gen_batched_std(F f = {}) {
     std::vector<R<F>> batched;
@@ -85,6 +153,10 @@ public:
 
 std::unique_ptr<Base> makeVirtualIota();
 
+// The source of the values is chosen at runtime: 0 is `std::views::iota`,
+// 1 `iota_gen_simple` and 2 `iota_gen_batched`.
+batched::any_generator<size_t> makeAnyIota(int source);
+
 int indirectFunction();
 
 
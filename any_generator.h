@@ -0,0 +1,281 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_ANY_GENERATOR_H
+#define STD_GENERATOR_EXAMPLES_ANY_GENERATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace batched {
+
+namespace detail {
+// A source with the batch API of `custom::generator`.
+template<typename S, typename T>
+concept has_next_batch = requires(S &s, std::span<T> out) {
+  { s.next_batch(out) } -> std::same_as<size_t>;
+};
+
+// A range of batches of `T`, e.g. `batched::generator<T>`.
+template<typename R, typename T>
+concept batch_range = !has_next_batch<R, T> && !std::convertible_to<std::ranges::range_reference_t<R>, T>
+                      && std::ranges::input_range<std::ranges::range_reference_t<R>>;
+
+// The state of a type-erased source: the source itself and, once it has
+// been started, the position in it.
+template<typename R, typename T>
+struct any_source {
+  R M_range;
+  std::optional<std::ranges::iterator_t<R>> M_it;
+
+  explicit any_source(R range) : M_range{std::move(range)} {}
+
+  auto &M_begin() {
+    if (!M_it) {
+      M_it.emplace(std::ranges::begin(M_range));
+    }
+    return *M_it;
+  }
+
+  // Write up to `n` elements to `out`, returns the number written.
+  size_t M_fill(T *out, size_t n) {
+    auto &it = M_begin();
+    const auto end = std::ranges::end(M_range);
+    size_t i = 0;
+    for (; i < n && it != end; ++it) {
+      out[i++] = *it;
+    }
+    return i;
+  }
+};
+
+// A range of batches, e.g. `batched::generator`, the elements are moved out
+// of the current batch in bulk.
+template<typename R, typename T>
+requires batch_range<R, T>
+struct any_source<R, T> {
+  static_assert(std::is_reference_v<std::ranges::range_reference_t<R>>,
+                "The batches must outlive the dereferencing of the iterator");
+
+  using Inner = std::ranges::iterator_t<std::ranges::range_reference_t<R>>;
+
+  R M_range;
+  std::optional<std::ranges::iterator_t<R>> M_it;
+  std::optional<Inner> M_cur;
+  std::optional<Inner> M_end;
+
+  explicit any_source(R range) : M_range{std::move(range)} {}
+
+  size_t M_fill(T *out, size_t n) {
+    if (!M_it) {
+      M_it.emplace(std::ranges::begin(M_range));
+      M_enter();
+    }
+    auto &it = *M_it;
+    const auto end = std::ranges::end(M_range);
+    size_t i = 0;
+    while (i < n && it != end) {
+      if (*M_cur == *M_end) {
+        ++it;
+        M_enter();
+        continue;
+      }
+      const auto k = std::min(n - i, static_cast<size_t>(std::ranges::distance(*M_cur, *M_end)));
+      auto last = std::ranges::next(*M_cur, k);
+      std::move(*M_cur, last, out + i);
+      *M_cur = last;
+      i += k;
+    }
+    return i;
+  }
+
+  void M_enter() {
+    if (*M_it != std::ranges::end(M_range)) {
+      auto &&batch = **M_it;
+      M_cur.emplace(std::ranges::begin(batch));
+      M_end.emplace(std::ranges::end(batch));
+    }
+  }
+};
+
+// `custom::generator` writes directly into the span.
+template<typename R, typename T>
+requires has_next_batch<R, T>
+struct any_source<R, T> {
+  R M_range;
+
+  explicit any_source(R range) : M_range{std::move(range)} {}
+
+  size_t M_fill(T *out, size_t n) { return M_range.next_batch(std::span<T>{out, n}); }
+};
+} // namespace detail
+
+/// A generator of `T` that can hold any of the generators of this project or
+/// any other range of `T` or of batches of `T`, chosen at runtime. In
+/// contrast to a virtual `get_next()` per element, the source is called
+/// through a function pointer once per batch, and the elements are consumed
+/// from a contiguous buffer. Sources of up to `inline_size` bytes are stored
+/// inline without an allocation. `T` must be default constructible. The
+/// elements of ranges of batches and rvalue elements are moved into the
+/// buffer, the elements of other ranges whose reference type is an lvalue,
+/// e.g. a `std::vector<T>`, are copied.
+template<typename T>
+class any_generator : public std::ranges::view_interface<any_generator<T>> {
+public:
+  /// The size of the sources that are stored without an allocation.
+  static constexpr size_t inline_size = 64;
+
+private:
+  using Fill_fn = size_t (*)(void *, T *, size_t);
+
+  struct Ops {
+    void (*M_move)(void *dst, void *src) noexcept;
+    void (*M_destroy)(void *) noexcept;
+  };
+
+  template<typename S>
+  static constexpr bool Is_inline = sizeof(S) <= inline_size && alignof(S) <= alignof(std::max_align_t)
+                                    && std::is_nothrow_move_constructible_v<S>;
+
+  template<typename S>
+  static S &M_get(void *storage) noexcept {
+    if constexpr (Is_inline<S>) {
+      return *std::launder(static_cast<S *>(storage));
+    } else {
+      return **static_cast<S **>(storage);
+    }
+  }
+
+  template<typename S>
+  static constexpr Ops Ops_for{
+          [](void *dst, void *src) noexcept {
+            if constexpr (Is_inline<S>) {
+              ::new(dst) S(std::move(M_get<S>(src)));
+              M_get<S>(src).~S();
+            } else {
+              *static_cast<S **>(dst) = *static_cast<S **>(src);
+            }
+          },
+          [](void *storage) noexcept {
+            if constexpr (Is_inline<S>) {
+              M_get<S>(storage).~S();
+            } else {
+              delete *static_cast<S **>(storage);
+            }
+          }};
+
+  struct Iterator;
+
+public:
+  /// Wrap `source`, e.g. a `custom::generator<T>`, a `batched::generator<T>`
+  /// or `std::views::iota(0)`. Iteration reads `batch_size` elements per
+  /// call into the source.
+  template<std::ranges::viewable_range R>
+  requires (!std::same_as<std::remove_cvref_t<R>, any_generator>)
+  explicit any_generator(R &&source, size_t batch_size = 256) : M_batch_size{std::max(batch_size, size_t{1})} {
+    using S = detail::any_source<std::views::all_t<R>, T>;
+    if constexpr (Is_inline<S>) {
+      ::new(static_cast<void *>(M_storage)) S(std::views::all(std::forward<R>(source)));
+    } else {
+      *reinterpret_cast<S **>(M_storage) = new S(std::views::all(std::forward<R>(source)));
+    }
+    M_fill = [](void *storage, T *out, size_t n) { return M_get<S>(storage).M_fill(out, n); };
+    M_ops = &Ops_for<S>;
+  }
+
+  any_generator(any_generator &&other) noexcept
+          : M_fill{std::exchange(other.M_fill, nullptr)}, M_ops{std::exchange(other.M_ops, nullptr)},
+            M_batch_size{other.M_batch_size}, M_buffer{std::move(other.M_buffer)} {
+    if (M_ops) {
+      M_ops->M_move(M_storage, other.M_storage);
+    }
+  }
+
+  any_generator &
+  operator=(any_generator &&other) noexcept {
+    if (this != &other) {
+      this->~any_generator();
+      ::new(this) any_generator(std::move(other));
+    }
+    return *this;
+  }
+
+  ~any_generator() {
+    if (M_ops) {
+      M_ops->M_destroy(M_storage);
+    }
+  }
+
+  /// Write up to `out.size()` elements to `out`, the same as
+  /// `custom::generator::next_batch`. Returns 0 at the end.
+  size_t
+  next_batch(std::span<T> out) { return out.empty() ? 0 : M_fill(M_storage, out.data(), out.size()); }
+
+  Iterator begin();
+
+  std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+private:
+  alignas(std::max_align_t) unsigned char M_storage[inline_size];
+  Fill_fn M_fill = nullptr;
+  const Ops *M_ops = nullptr;
+  size_t M_batch_size;
+  std::vector<T> M_buffer;
+};
+
+template<typename T>
+struct any_generator<T>::Iterator {
+  using value_type = T;
+  using difference_type = ptrdiff_t;
+
+  Iterator() = default;
+
+  explicit Iterator(any_generator *gen) : M_gen{gen} { M_refill(); }
+
+  friend bool
+  operator==(const Iterator &i, std::default_sentinel_t) noexcept { return i.M_cur == i.M_end; }
+
+  Iterator &
+  operator++() {
+    if (++M_cur == M_end) [[unlikely]] {
+      M_refill();
+    }
+    return *this;
+  }
+
+  void
+  operator++(int) { this->operator++(); }
+
+  T &operator*() const noexcept { return *M_cur; }
+
+private:
+  void M_refill() {
+    auto &buffer = M_gen->M_buffer;
+    const size_t n = M_gen->next_batch(buffer);
+    M_cur = buffer.data();
+    M_end = M_cur + n;
+  }
+
+  any_generator *M_gen = nullptr;
+  T *M_cur = nullptr;
+  T *M_end = nullptr;
+};
+
+template<typename T>
+auto any_generator<T>::begin() -> Iterator {
+  M_buffer.resize(M_batch_size);
+  return Iterator{this};
+}
+
+} // namespace batched
+
+#endif //STD_GENERATOR_EXAMPLES_ANY_GENERATOR_H
@@ -0,0 +1,109 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_ARG_BUFFER_POOL_H
+#define STD_GENERATOR_EXAMPLES_ARG_BUFFER_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+// A thread-local pool of the `std::vector<double>` buffers that back `Arg`s.
+// The buffers are bucketed by the power of two of their capacity, so that a
+// buffer that is released by one step of an expression is handed out again
+// for the identically sized result of the next step. At most
+// `MAX_RETAINED_BYTES` are kept per thread, larger buffers are freed.
+class ArgBufferPool {
+public:
+    // The buffers of at most this many elements have a capacity that is
+    // rounded up to a power of two. Larger ones are allocated with the
+    // exact size, rounding them would waste up to half of their memory.
+    static constexpr size_t ROUND_LIMIT = size_t{1} << 16;
+    static constexpr size_t MAX_RETAINED_BYTES = size_t{256} << 20;
+
+    static ArgBufferPool& local() {
+        thread_local ArgBufferPool pool;
+        return pool;
+    }
+
+    // A vector of size `n`, the contents are unspecified.
+    std::vector<double> acquire(size_t n) {
+        auto vec = take(n);
+        if (vec.capacity() == 0) {
+            // Round the capacity up, otherwise the buffer would be released
+            // into the bucket below and only match requests of the same size.
+            vec.reserve(n <= ROUND_LIMIT ? std::bit_ceil(n) : n);
+        }
+        // Only writes if the recycled buffer was shorter than `n`.
+        vec.resize(n);
+        return vec;
+    }
+
+    // Hand a buffer back to the pool, it is freed if the bucket is full or
+    // the pool already retains `MAX_RETAINED_BYTES`.
+    void release(std::vector<double>&& vec) {
+        const size_t bytes = vec.capacity() * sizeof(double);
+        if (bytes == 0 || retainedBytes_ + bytes > MAX_RETAINED_BYTES) {
+            return;
+        }
+        auto& bucket = buckets_[bucketForCapacity(vec.capacity())];
+        if (bucket.size() < MAX_PER_BUCKET) {
+            retainedBytes_ += bytes;
+            bucket.push_back(std::move(vec));
+        }
+    }
+
+    // Free all buffers of this thread's pool.
+    void trim() {
+        for (auto& bucket : buckets_) {
+            bucket.clear();
+            bucket.shrink_to_fit();
+        }
+        retainedBytes_ = 0;
+    }
+
+    size_t retainedBytes() const { return retainedBytes_; }
+
+private:
+    static constexpr size_t NUM_BUCKETS = 64;
+    static constexpr size_t MAX_PER_BUCKET = 8;
+
+    // Every buffer in bucket `b` has a capacity in `[2^b, 2^(b + 1))`.
+    static size_t bucketForSize(size_t n) { return std::bit_width(n - (n != 0)); }
+    static size_t bucketForCapacity(size_t capacity) { return std::bit_width(capacity) - 1; }
+
+    // A pooled buffer with a capacity of at least `n`, or an empty vector.
+    std::vector<double> take(size_t n) {
+        // A buffer of the exact size `n` is in the bucket below
+        // `bucketForSize(n)` if `n` is not a power of two.
+        if (n > ROUND_LIMIT) {
+            auto& bucket = buckets_[bucketForCapacity(n)];
+            auto it = std::ranges::find_if(bucket, [n](const auto& vec) { return vec.capacity() >= n; });
+            if (it != bucket.end()) {
+                return take(bucket, it);
+            }
+        }
+        auto& bucket = buckets_[bucketForSize(n)];
+        if (bucket.empty()) {
+            return {};
+        }
+        return take(bucket, bucket.end() - 1);
+    }
+
+    std::vector<double> take(std::vector<std::vector<double>>& bucket,
+                             std::vector<std::vector<double>>::iterator it) {
+        auto vec = std::move(*it);
+        std::swap(*it, bucket.back());
+        bucket.pop_back();
+        retainedBytes_ -= vec.capacity() * sizeof(double);
+        return vec;
+    }
+
+    std::array<std::vector<std::vector<double>>, NUM_BUCKETS> buckets_;
+    size_t retainedBytes_ = 0;
+};
+
+#endif //STD_GENERATOR_EXAMPLES_ARG_BUFFER_POOL_H
@@ -0,0 +1,270 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_ASYNC_FILE_H
+#define STD_GENERATOR_EXAMPLES_ASYNC_FILE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./thread_pool.h"
+
+// `HAVE_LIBURING` is defined by the build if liburing is installed.
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+struct AsyncReadOptions {
+    // The size of a chunk, rounded up to a multiple of 4096 for `direct`.
+    size_t chunkBytes = 1 << 20;
+    // The number of chunks that are read ahead of the consumer.
+    size_t inFlight = 8;
+    // Bypass the page cache with `O_DIRECT`, for files that are larger than
+    // the memory. Falls back to buffered reads if the file system does not
+    // support it.
+    bool direct = false;
+};
+
+// Reads a file front to back with up to `inFlight` chunks in flight, so
+// that the consumer works on one chunk while the next ones are read. The
+// reads are submitted to io_uring if it is available and allowed, otherwise
+// a small pool of threads calls `pread`. Every chunk has its own buffer,
+// which is reused for the read ahead as soon as the consumer asks for the
+// chunk after it.
+class AsyncFileReader {
+public:
+    static constexpr size_t ALIGNMENT = 4096;
+
+    AsyncFileReader(const std::string& path, AsyncReadOptions options)
+        : chunkBytes_{std::max(options.chunkBytes, size_t{1})}, numSlots_{std::max(options.inFlight, size_t{1})} {
+        if (options.direct) {
+            chunkBytes_ = (chunkBytes_ + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            fd_.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+            direct_ = fd_.fd >= 0;
+        }
+        if (fd_.fd < 0) {
+            fd_.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+        if (fd_.fd < 0) {
+            throw std::system_error{errno, std::generic_category(), "Could not open " + path};
+        }
+        struct stat st{};
+        if (::fstat(fd_.fd, &st) != 0) {
+            throw std::system_error{errno, std::generic_category(), "Could not stat " + path};
+        }
+        fileSize_ = static_cast<size_t>(st.st_size);
+        if (!direct_) {
+            ::posix_fadvise(fd_.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+
+        slots_ = std::make_unique<Slot[]>(numSlots_);
+        for (size_t i = 0; i < numSlots_; ++i) {
+            slots_[i].data.reset(static_cast<std::byte*>(::operator new(chunkBytes_, std::align_val_t{ALIGNMENT})));
+        }
+#ifdef HAVE_LIBURING
+        // Not allowed in some containers, then the threads are used.
+        useRing_ = io_uring_queue_init(static_cast<unsigned>(numSlots_), &ring_, 0) == 0;
+#endif
+        if (!useRing_) {
+            pool_.emplace(numSlots_ + 1);
+        }
+        for (size_t i = 0; i < numSlots_; ++i) {
+            submit(slots_[i]);
+        }
+    }
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    ~AsyncFileReader() {
+        // The reads still write into the buffers, wait for them.
+        for (size_t i = 0; i < numSlots_; ++i) {
+            if (slots_[i].submitted) {
+                wait(slots_[i]);
+            }
+        }
+        pool_.reset();
+#ifdef HAVE_LIBURING
+        if (useRing_) {
+            io_uring_queue_exit(&ring_);
+        }
+#endif
+    }
+
+    size_t fileSize() const { return fileSize_; }
+
+    // Whether the reads go through io_uring.
+    bool usesIoUring() const { return useRing_; }
+
+    // The next chunk of the file, empty at the end. Throws
+    // `std::system_error` if the read failed. The chunk stays valid until
+    // the next call.
+    std::span<const std::byte> next() {
+        if (current_) {
+            // The consumer is done with the previous chunk, read ahead into it.
+            submit(*current_);
+        }
+        Slot& slot = slots_[nextSlot_];
+        if (!slot.submitted) {
+            current_ = nullptr;
+            return {};
+        }
+        nextSlot_ = (nextSlot_ + 1) % numSlots_;
+        wait(slot);
+        slot.submitted = false;
+        current_ = &slot;
+        if (slot.error != 0) {
+            throw std::system_error{slot.error, std::generic_category(), "Could not read the file"};
+        }
+        return {slot.data.get(), slot.length};
+    }
+
+private:
+    // Closes the file, also if the constructor throws.
+    struct FileDescriptor {
+        int fd = -1;
+
+        FileDescriptor() = default;
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+        ~FileDescriptor() {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    };
+
+    struct AlignedDelete {
+        void operator()(std::byte* data) const { ::operator delete(data, std::align_val_t{ALIGNMENT}); }
+    };
+
+    struct Slot {
+        std::unique_ptr<std::byte, AlignedDelete> data;
+        size_t offset = 0;
+        // The number of bytes to read, and after the read the number read.
+        size_t length = 0;
+        int error = 0;
+        bool submitted = false;
+        std::atomic<bool> done{false};
+    };
+
+    // Start reading the next chunk of the file into `slot`, if any.
+    void submit(Slot& slot) {
+        if (nextOffset_ >= fileSize_) {
+            return;
+        }
+        slot.offset = nextOffset_;
+        slot.length = std::min(chunkBytes_, fileSize_ - nextOffset_);
+        slot.error = 0;
+        slot.done.store(false, std::memory_order_relaxed);
+        slot.submitted = true;
+        nextOffset_ += slot.length;
+#ifdef HAVE_LIBURING
+        if (useRing_) {
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+            // There is one entry per slot, so the queue is never full.
+            io_uring_prep_read(sqe, fd_.fd, slot.data.get(), static_cast<unsigned>(requestLength(slot)), slot.offset);
+            io_uring_sqe_set_data(sqe, &slot);
+            io_uring_submit(&ring_);
+            return;
+        }
+#endif
+        pool_->submit([this, &slot] {
+            readRest(slot, 0);
+            slot.done.store(true, std::memory_order_release);
+            slot.done.notify_one();
+        });
+    }
+
+    // Wait until the read into `slot` is finished.
+    void wait(Slot& slot) {
+#ifdef HAVE_LIBURING
+        if (useRing_) {
+            // The completions may arrive in any order.
+            while (!slot.done.load(std::memory_order_relaxed)) {
+                io_uring_cqe* cqe = nullptr;
+                const int res = io_uring_wait_cqe(&ring_, &cqe);
+                if (res == -EINTR) {
+                    continue;
+                }
+                if (res < 0) {
+                    throw std::system_error{-res, std::generic_category(), "io_uring_wait_cqe failed"};
+                }
+                auto* completed = static_cast<Slot*>(io_uring_cqe_get_data(cqe));
+                const int bytes = cqe->res;
+                io_uring_cqe_seen(&ring_, cqe);
+                if (bytes < 0) {
+                    completed->error = -bytes;
+                } else {
+                    // A short read is completed synchronously, it is rare
+                    // for a regular file.
+                    readRest(*completed, static_cast<size_t>(bytes));
+                }
+                completed->done.store(true, std::memory_order_relaxed);
+            }
+            return;
+        }
+#endif
+        slot.done.wait(false, std::memory_order_acquire);
+    }
+
+    // With `O_DIRECT` the length of a read must be aligned, the last chunk
+    // of the file then simply ends early.
+    size_t requestLength(const Slot& slot) const {
+        return direct_ ? (slot.length + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT : slot.length;
+    }
+
+    // Read `[slot.offset + done, slot.offset + slot.length)` with `pread`,
+    // sets `slot.length` to the number of bytes that were read in total.
+    void readRest(Slot& slot, size_t done) {
+        while (done < slot.length) {
+            const ssize_t res = ::pread(fd_.fd, slot.data.get() + done, requestLength(slot) - done,
+                                        static_cast<off_t>(slot.offset + done));
+            if (res < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                slot.error = errno;
+                return;
+            }
+            if (res == 0) {
+                break;
+            }
+            done += static_cast<size_t>(res);
+        }
+        slot.length = std::min(done, slot.length);
+    }
+
+    // Declared before the buffers and the pool, so that it is closed after
+    // the reads into the buffers are finished.
+    FileDescriptor fd_;
+    size_t fileSize_ = 0;
+    size_t chunkBytes_;
+    size_t numSlots_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t nextOffset_ = 0;
+    size_t nextSlot_ = 0;
+    Slot* current_ = nullptr;
+    bool direct_ = false;
+    bool useRing_ = false;
+#ifdef HAVE_LIBURING
+    io_uring ring_{};
+#endif
+    std::optional<ThreadPool> pool_;
+};
+
+#endif //STD_GENERATOR_EXAMPLES_ASYNC_FILE_H
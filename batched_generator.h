@@ -35,16 +35,117 @@
 #include <coroutine>
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <chrono>
 
 #include <type_traits>
 #include <concepts>
+#include <optional>
+#include <memory>
+#include <atomic>
+#include <exception>
+#include <new>
 
+#include "./generator_instrumentation.h"
+#include "./generator_stop.h"
+
+#ifndef BATCHED_GENERATOR_BATCH_BYTES
+#define BATCHED_GENERATOR_BATCH_BYTES 4096
+#endif
 
 namespace batched {
 
-constexpr static size_t BATCH_SIZE = 100;
 using namespace std;
 
+using generator_stop::stop_token;
+using generator_stop::get_stop_token;
+
+/// The default number of bytes a single batch occupies. Small enough that a
+/// batch of numbers stays in L1 while the consumer works on it.
+constexpr static size_t BATCH_BYTES = BATCHED_GENERATOR_BATCH_BYTES;
+
+/// The number of elements of type `T` that fit into a batch of `Bytes` bytes.
+template<typename T, size_t Bytes = BATCH_BYTES>
+constexpr static size_t batch_size_for = std::max(size_t{1}, Bytes / sizeof(T));
+
+/// Bounds for the adaptive batch size, see `generator::set_adaptive`.
+struct adaptive_batching {
+  size_t min_size = 16;
+  size_t max_size = 1 << 16;
+  // The consumer should need about this long to drain a single batch. Faster
+  // consumers get larger batches to amortize the resumption of the producer,
+  // slower ones get smaller batches that stay in cache.
+  std::chrono::nanoseconds target_drain_time{20'000};
+};
+
+/// A batch of elements in fixed-capacity, cache-line aligned storage. The
+/// storage is allocated once and never reallocated, and clearing a batch of
+/// trivially destructible elements is a no-op.
+template<typename T>
+class batch {
+public:
+  static constexpr size_t alignment = std::max(size_t{64}, alignof(T));
+
+  using value_type = T;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  batch() = default;
+
+  batch(const batch &) = delete;
+
+  batch &operator=(const batch &) = delete;
+
+  ~batch() { release(); }
+
+  /// Allocate the storage for `capacity` elements. Must be called at most
+  /// once, before the first element is added.
+  void allocate(size_t capacity) {
+    M_data = static_cast<T *>(::operator new(capacity * sizeof(T), std::align_val_t{alignment}));
+    M_capacity = capacity;
+  }
+
+  template<typename... Args>
+  __attribute__((always_inline)) T &emplace_back(Args &&... args) {
+    return *std::construct_at(M_data + M_size++, std::forward<Args>(args)...);
+  }
+
+  void clear() noexcept {
+    if constexpr (!is_trivially_destructible_v<T>) {
+      std::destroy_n(M_data, M_size);
+    }
+    M_size = 0;
+  }
+
+  /// Destroy the elements and free the storage.
+  void release() noexcept {
+    clear();
+    if (M_data) {
+      ::operator delete(M_data, std::align_val_t{alignment});
+    }
+    M_data = nullptr;
+    M_capacity = 0;
+  }
+
+  T *data() noexcept { return M_data; }
+  const T *data() const noexcept { return M_data; }
+  T *begin() noexcept { return M_data; }
+  T *end() noexcept { return M_data + M_size; }
+  const T *begin() const noexcept { return M_data; }
+  const T *end() const noexcept { return M_data + M_size; }
+  size_t size() const noexcept { return M_size; }
+  size_t capacity() const noexcept { return M_capacity; }
+  bool empty() const noexcept { return M_size == 0; }
+  T &operator[](size_t i) noexcept { return M_data[i]; }
+  T &front() noexcept { return M_data[0]; }
+  T &back() noexcept { return M_data[M_size - 1]; }
+
+private:
+  T *M_data = nullptr;
+  size_t M_size = 0;
+  size_t M_capacity = 0;
+};
+
 /** @brief A range specified using a yielding coroutine.
  *
  * `std::generator` is a utility class for defining ranges using coroutines
@@ -53,9 +154,19 @@ using namespace std;
  * @headerfile generator
  * @since C++23
  */
-template<typename val>
+template<typename val, size_t BatchBytes = BATCH_BYTES>
 class generator;
 
+template<typename T>
+class batch_sink;
+
+struct get_batch_sink_t {
+  explicit get_batch_sink_t() = default;
+};
+
+/// `co_await get_batch_sink` in a generator yields its `batch_sink`.
+inline constexpr get_batch_sink_t get_batch_sink{};
+
 namespace gen {
 /// Reference type for a generator whose reference (first argument) and
 /// value (second argument) types are Ref and Val.
@@ -68,10 +179,12 @@ template<typename Yielded>
 class Promise_erased {
   static_assert(is_object_v<Yielded>);
 
-  template<typename>
+  template<typename, size_t>
   friend
   class batched::generator;
 
+  friend class batched::batch_sink<Yielded>;
+
 public:
   suspend_always initial_suspend() const noexcept { return {}; }
 
@@ -90,24 +203,132 @@ public:
 
   template <typename T>
   __attribute__((always_inline)) SuspendIfAwaiter yield_value(T&& val) noexcept {
-    M_buffer_.emplace_back(std::forward<T>(val));
-    return {M_buffer_.size() >= BATCH_SIZE};
+    GENERATOR_RECORD_YIELD();
+    M_fill_->emplace_back(std::forward<T>(val));
+    return {M_fill_->size() >= M_batch_size_};
   }
   std::suspend_always
   final_suspend() noexcept { return {}; }
 
+  // Stored until the consumer has received the elements that were yielded
+  // before the exception, see `Iterator::M_at_end`.
   void unhandled_exception() {
     this->M_except = std::current_exception();
   }
 
   void await_transform() = delete;
 
+  /// `co_await` of a `custom::task` (see task.h), or anything else with a
+  /// nested `blocking_awaiter`. The generator is not suspended, the awaiter
+  /// completes the work while the consumer waits.
+  template<typename A>
+  requires requires { typename std::remove_cvref_t<A>::blocking_awaiter; }
+  typename std::remove_cvref_t<A>::blocking_awaiter
+  await_transform(A &&a) { return {std::forward<A>(a)}; }
+
+  generator_stop::stop_token_awaiter
+  await_transform(generator_stop::get_stop_token_t) noexcept {
+    return {stop_token{M_stop_}};
+  }
+
+  /// Never suspends, only hands out the sink.
+  struct Sink_awaiter {
+    Promise_erased *M_promise;
+
+    constexpr bool await_ready() const noexcept { return true; }
+
+    constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+    batch_sink<Yielded> await_resume() const noexcept { return batch_sink<Yielded>{*M_promise}; }
+  };
+
+  Sink_awaiter
+  await_transform(get_batch_sink_t) noexcept { return {this}; }
+
+  /// For `co_await sink.flush()`.
+  SuspendIfAwaiter
+  await_transform(SuspendIfAwaiter a) noexcept { return a; }
+
+#ifdef GENERATOR_INSTRUMENTATION
+  // Only to count the frames, the allocation itself is the default one.
+  static void *operator new(std::size_t sz) {
+    GENERATOR_RECORD_FRAME_ALLOC(sz);
+    return ::operator new(sz);
+  }
+
+  static void operator delete(void *ptr, std::size_t sz) noexcept {
+    GENERATOR_RECORD_FRAME_DEALLOC();
+    ::operator delete(ptr, sz);
+  }
+#endif
+
   void return_void() const noexcept {}
 
-  auto& M_buffer() noexcept { return M_buffer_; }
+  /// The batch that is currently filled by the producer and, while the
+  /// producer is suspended, read by the consumer.
+  auto& M_buffer() noexcept { return *M_fill_; }
+
+  /// Allocate both buffers, large enough for every batch size this
+  /// generator can switch to.
+  void M_allocate_buffers() {
+    if (M_buffers_[0].capacity() != 0) {
+      return;
+    }
+    auto capacity = M_adaptive_ ? M_adaptive_->max_size : M_batch_size_;
+    for (auto &b : M_buffers_) {
+      b.allocate(capacity);
+    }
+  }
+
+  /// Free both buffers once the consumer has reached the end.
+  void M_release_buffers() noexcept {
+    for (auto &b : M_buffers_) {
+      b.release();
+    }
+  }
+
+  /// Switch to the other buffer. The previous batch stays alive until the
+  /// batch after it is complete.
+  void M_flip() noexcept {
+    M_fill_ = M_fill_ == &M_buffers_[0] ? &M_buffers_[1] : &M_buffers_[0];
+    M_fill_->clear();
+  }
+
+  void M_set_batch_size(size_t n) noexcept {
+    M_batch_size_ = std::max(n, size_t{1});
+    if (auto capacity = M_buffers_[0].capacity()) {
+      M_batch_size_ = std::min(M_batch_size_, capacity);
+    }
+  }
+
+  // Called by the iterator when the consumer has received a batch and when
+  // it asks for the next one. Only does work in adaptive mode.
+  void M_batch_ready() noexcept {
+    if (M_adaptive_) {
+      M_ready_time_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  void M_batch_drained() noexcept {
+    if (!M_adaptive_) {
+      return;
+    }
+    auto drain_time = std::chrono::steady_clock::now() - M_ready_time_;
+    auto &a = *M_adaptive_;
+    if (drain_time < a.target_drain_time / 2) {
+      M_set_batch_size(std::min(M_batch_size_ * 2, a.max_size));
+    } else if (drain_time > a.target_drain_time * 2) {
+      M_set_batch_size(std::max(M_batch_size_ / 2, a.min_size));
+    }
+  }
 private:
 
-  std::vector<Yielded> M_buffer_;
+  batch<Yielded> M_buffers_[2];
+  batch<Yielded> *M_fill_ = &M_buffers_[0];
+  size_t M_batch_size_ = batch_size_for<Yielded>;
+  std::optional<adaptive_batching> M_adaptive_;
+  std::chrono::steady_clock::time_point M_ready_time_;
+  std::atomic<bool> M_stop_{false};
   std::exception_ptr M_except;
 };
 
@@ -119,8 +340,51 @@ private:
 } // namespace gen
 /// @endcond
 
+/// Direct access to the batch that a generator is currently filling, for
+/// code that produces many elements at once, e.g. the combinators in
+/// `generator_combinators.h`. Instead of a `co_yield` per element, which is
+/// a potential suspension point, the coroutine writes up to `room()`
+/// elements in a plain loop and then calls `co_await sink.flush()`, which
+/// hands the batch to the consumer if it is full:
+///
+///   auto sink = co_await batched::get_batch_sink;
+///   while (more()) {
+///     for (size_t n = sink.room(); n > 0 && more(); --n)
+///       sink.emplace_back(next());
+///     co_await sink.flush();
+///   }
+///
+/// The elements are handed out in the same batches as with `co_yield`, and
+/// both can be mixed. Only valid while the coroutine that obtained it is
+/// alive.
 template<typename T>
-class generator : public ranges::view_interface<generator<T>> {
+class batch_sink {
+public:
+  explicit batch_sink(gen::Promise_erased<T> &promise) noexcept: M_promise{&promise} {}
+
+  /// The number of elements that can be added before the batch is full.
+  size_t room() const noexcept {
+    auto size = M_promise->M_fill_->size();
+    return M_promise->M_batch_size_ > size ? M_promise->M_batch_size_ - size : 0;
+  }
+
+  template<typename... Args>
+  __attribute__((always_inline)) T &emplace_back(Args &&... args) {
+    GENERATOR_RECORD_YIELD();
+    return M_promise->M_fill_->emplace_back(std::forward<Args>(args)...);
+  }
+
+  /// Suspend until the consumer asks for the next batch if the current one
+  /// is full, otherwise continue immediately.
+  typename gen::Promise_erased<T>::SuspendIfAwaiter
+  flush() const noexcept { return {room() == 0}; }
+
+private:
+  gen::Promise_erased<T> *M_promise;
+};
+
+template<typename T, size_t BatchBytes>
+class generator : public ranges::view_interface<generator<T, BatchBytes>> {
   using Erased_promise = gen::Promise_erased<T>;
   friend Erased_promise;
 
@@ -128,9 +392,42 @@ class generator : public ranges::view_interface<generator<T>> {
 
 public:
   struct promise_type : Erased_promise {
+    promise_type() noexcept { this->M_set_batch_size(batch_size_for<T, BatchBytes>); }
+
     generator get_return_object() noexcept { return {coroutine_handle<promise_type>::from_promise(*this)}; }
   };
 
+  /// Set the number of elements per batch. Takes effect with the next batch.
+  /// Once iteration has started, the size can not exceed the initial one.
+  void set_batch_size(size_t n) noexcept {
+    M_coro.promise().M_set_batch_size(n);
+  }
+
+  /// Set the size of a batch in bytes instead of elements.
+  void set_batch_bytes(size_t bytes) noexcept {
+    set_batch_size(bytes / sizeof(T));
+  }
+
+  /// Grow or shrink the batch size depending on how long the consumer needs
+  /// to drain a batch, see `adaptive_batching`. Should be called before
+  /// `begin()`, afterwards the batches can not grow beyond the buffers that
+  /// were already allocated.
+  void set_adaptive(adaptive_batching bounds = {}) noexcept {
+    auto &p = M_coro.promise();
+    p.M_adaptive_ = bounds;
+    p.M_set_batch_size(std::clamp(p.M_batch_size_, bounds.min_size, bounds.max_size));
+  }
+
+  /// The size of the batches that are currently produced.
+  size_t batch_size() const noexcept { return M_coro.promise().M_batch_size_; }
+
+  /// Ask the coroutine to finish after the current batch, see
+  /// `generator_stop.h`. The batches that were already produced are still
+  /// handed out.
+  void request_stop() noexcept { M_coro.promise().M_stop_.store(true, std::memory_order_relaxed); }
+
+  bool stop_requested() const noexcept { return M_coro.promise().M_stop_.load(std::memory_order_relaxed); }
+
   generator(const generator &) = delete;
 
   generator(generator &&other) noexcept
@@ -162,17 +459,17 @@ private:
   coroutine_handle<promise_type> M_coro;
 };
 
-template<class T>
-struct generator<T>::Iterator {
-  using value_type = std::vector<T>;
-  using reference  = std::vector<T>&;
+template<class T, size_t BatchBytes>
+struct generator<T, BatchBytes>::Iterator {
+  using value_type = batch<T>;
+  using reference  = batch<T>&;
   using difference_type = ptrdiff_t;
   using BufferPtr = std::add_pointer_t<std::remove_reference_t<decltype(std::declval<Coro_handle>().promise().M_buffer())>>;
 
   friend bool
   operator==(const Iterator &i, default_sentinel_t) noexcept {
     return
-        i.M_coro.done();
+        i.M_coro.done() && i.M_coro.promise().M_buffer().empty();
   }
 
   friend class generator;
@@ -188,14 +485,27 @@ struct generator<T>::Iterator {
 
   Iterator &
   operator++() {
-      M_coro.promise().M_buffer().clear();
-      M_coro.resume();
+      auto &p = M_coro.promise();
+      p.M_batch_drained();
+      p.M_flip();
+      // The last batch of a finished generator is not full, hand it out
+      // before reporting the end.
+      if (!M_coro.done()) {
+        GENERATOR_RECORD_RESUME();
+        M_coro.resume();
+      }
+      if (M_coro.done()) [[unlikely]] {
+        M_at_end();
+      }
+      p.M_batch_ready();
     return *this;
   }
 
   void
   operator++(int) { this->operator++(); }
 
+  // The returned batch stays valid until the batch after it is complete,
+  // so it may still be read while the next batch is produced.
   reference operator*()
   const noexcept {
     return M_coro.promise().M_buffer();
@@ -205,11 +515,74 @@ private:
   friend class generator;
 
   Iterator(Coro_handle g)
-          : M_coro{g}  { M_coro.resume(); }
+          : M_coro{g}  {
+    M_coro.promise().M_allocate_buffers();
+    GENERATOR_RECORD_RESUME();
+    M_coro.resume();
+    if (M_coro.done()) [[unlikely]] {
+      M_at_end();
+    }
+    M_coro.promise().M_batch_ready();
+  }
+
+  // Once the last batch has been handed out, free the buffers and throw
+  // the exception of the coroutine, if any. This is only checked once per
+  // batch, and only when the coroutine is finished.
+  void M_at_end() {
+    auto &p = M_coro.promise();
+    if (!p.M_buffer().empty()) {
+      return;
+    }
+    p.M_release_buffers();
+    if (auto e = std::exchange(p.M_except, nullptr)) {
+      std::rethrow_exception(e);
+    }
+  }
 
   Coro_handle M_coro;
 };
 
+/// Whether `R` is a range of batches whose elements are meant to be
+/// consumed one by one, e.g. a `generator`. `prefetch` and the stages of a
+/// pipeline flatten such ranges, any other range is a range of elements,
+/// even if its elements are ranges themselves. Other ranges of batches opt
+/// in by specializing this.
+template<typename R>
+inline constexpr bool enable_batch_range = false;
+
+template<typename T, size_t BatchBytes>
+inline constexpr bool enable_batch_range<generator<T, BatchBytes>> = true;
+
+template<typename R>
+inline constexpr bool enable_batch_range<ranges::ref_view<R>> = enable_batch_range<remove_cv_t<R>>;
+
+template<typename R>
+inline constexpr bool enable_batch_range<ranges::owning_view<R>> = enable_batch_range<R>;
+
+/// A range of batches that is not known as such, e.g. a
+/// `std::generator<std::vector<T>&>`, see `as_batches`.
+template<ranges::view V>
+class batches_view : public ranges::view_interface<batches_view<V>> {
+public:
+  explicit batches_view(V base) noexcept(is_nothrow_move_constructible_v<V>) : M_base{std::move(base)} {}
+
+  auto begin() { return ranges::begin(M_base); }
+
+  auto end() { return ranges::end(M_base); }
+
+private:
+  V M_base;
+};
+
+template<typename V>
+inline constexpr bool enable_batch_range<batches_view<V>> = true;
+
+/// Mark `r` as a range of batches, so that `prefetch` and the stages of a
+/// pipeline consume the elements of its batches.
+template<ranges::viewable_range R>
+batches_view<views::all_t<R>>
+as_batches(R &&r) { return batches_view<views::all_t<R>>{views::all(std::forward<R>(r))}; }
+
 /// @}
 
 } // namespace std
@@ -0,0 +1,88 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_BENCHMARK_COUNTERS_H
+#define STD_GENERATOR_EXAMPLES_BENCHMARK_COUNTERS_H
+
+#include <benchmark/benchmark.h>
+#include <string>
+
+#include "./generator_instrumentation.h"
+#include "./perf_counters.h"
+
+// Reports counters for the lifetime of the scope as `state.counters`, per
+// item if the benchmark calls `SetItemsProcessed` and per iteration
+// otherwise:
+// - The hardware counters of `perf_counters.h`, `cycles`, `instructions`,
+//   `branch_misses` and `l1d_misses` per item and the `IPC`. Counters that
+//   are not available on the machine are left out, without any of them the
+//   benchmark only reports the time.
+// - The generator counters of `generator_instrumentation.h` if the benchmark
+//   is compiled with `GENERATOR_INSTRUMENTATION`.
+// Put it first in the benchmark, so that it also covers the creation of the
+// generators and is destroyed after `SetItemsProcessed`.
+class CounterScope {
+public:
+    explicit CounterScope(benchmark::State& state) : state_{state} {}
+
+    CounterScope(const CounterScope&) = delete;
+    CounterScope& operator=(const CounterScope&) = delete;
+
+    ~CounterScope() {
+        const auto hardware = perf_.read();
+        auto items = static_cast<double>(state_.items_processed());
+        if (items == 0) {
+            items = static_cast<double>(state_.iterations());
+        }
+        if (items == 0) {
+            return;
+        }
+        auto report = [&](const std::string& name, double value) { state_.counters[name] = value / items; };
+
+        const auto& [cycles, instructions, branchMisses, l1dMisses] = hardware;
+        if (cycles) {
+            report("cycles/item", *cycles);
+        }
+        if (instructions) {
+            report("instructions/item", *instructions);
+        }
+        if (cycles && instructions && *cycles > 0) {
+            state_.counters["IPC"] = *instructions / *cycles;
+        }
+        if (branchMisses) {
+            report("branch_misses/item", *branchMisses);
+        }
+        if (l1dMisses) {
+            report("l1d_misses/item", *l1dMisses);
+        }
+
+#ifdef GENERATOR_INSTRUMENTATION
+        using namespace generator_instrumentation;
+        const auto end = take_snapshot();
+        auto reportCount = [&](const std::string& name, size_t value) { report(name, static_cast<double>(value)); };
+        reportCount("allocs/item", end.frame_allocs - start_.frame_allocs);
+        reportCount("frame_bytes/item", end.frame_bytes - start_.frame_bytes);
+        reportCount("resumes/item", end.resumes - start_.resumes);
+        reportCount("yields/item", end.yields - start_.yields);
+        // One counter per frame size, e.g. `frames_128B/item`.
+        for (const auto& [size, count] : end.sizes) {
+            auto it = start_.sizes.find(size);
+            const size_t before = it == start_.sizes.end() ? 0 : it->second;
+            if (count != before) {
+                reportCount("frames_" + std::to_string(size) + "B/item", count - before);
+            }
+        }
+#endif
+    }
+
+private:
+    benchmark::State& state_;
+#ifdef GENERATOR_INSTRUMENTATION
+    generator_instrumentation::snapshot start_ = generator_instrumentation::take_snapshot();
+#endif
+    // Declared last, so that the hardware counters start after the snapshot.
+    PerfCounters perf_;
+};
+
+#endif //STD_GENERATOR_EXAMPLES_BENCHMARK_COUNTERS_H
@@ -2,13 +2,23 @@
 #define STD_GENERATOR_EXAMPLES_BINARY_EXPRESSION_H
 
 #include <generator>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "./arg_buffer_pool.h"
+#include "./expression_kernels.h"
+#include "./thread_pool.h"
+
 using Arg = std::variant<double, std::vector<double>>;
 
 using Exp = std::generator<Arg>;
 
-auto getResultSize(const Arg& arg1, const Arg& arg2) {
+// The size of the result of a binary operation. A scalar is broadcast to the
+// size of the other operand, also to an empty vector, which gives an empty
+// result. Two vectors must have the same size.
+inline size_t getResultSize(const Arg& arg1, const Arg& arg2) {
     auto getSingleSize = []<typename T>(const T& arg) -> size_t {
         if constexpr (std::same_as<T, double>) {
             (void) arg;
@@ -18,35 +28,112 @@ auto getResultSize(const Arg& arg1, const Arg& arg2) {
         }
     };
 
-  // TODO Check that sizes match.
-  return std::max(std::visit(getSingleSize, arg1), std::visit(getSingleSize, arg2));
+    const size_t size1 = std::visit(getSingleSize, arg1);
+    const size_t size2 = std::visit(getSingleSize, arg2);
+    if (std::holds_alternative<double>(arg1)) {
+        return size2;
+    }
+    if (std::holds_alternative<double>(arg2)) {
+        return size1;
+    }
+    if (size1 != size2) {
+        throw std::invalid_argument{"Operands of a binary expression have different sizes " + std::to_string(size1) +
+                                    " and " + std::to_string(size2)};
+    }
+    return size1;
 }
 
-auto yieldAll(double val, size_t n) {
-    return std::views::repeat(val, n);
+// Results with at least `threshold` elements are computed on all threads of
+// `pool` (the global pool if null). Smaller ones stay on the calling thread
+// without any synchronisation. Set this up before any expression is evaluated.
+struct ParallelConfig {
+    ThreadPool* pool = nullptr;
+    size_t threshold = size_t{1} << 18;
+};
+
+inline ParallelConfig& parallelConfig() {
+    static ParallelConfig config;
+    return config;
 }
-auto yieldAll(const std::vector<double>& vec, [[maybe_unused]] size_t n) -> decltype(auto) {
-    return vec;
+
+// `kernels::evaluate`, split across threads for large results.
+template <typename F, typename A, typename B, typename R>
+void evaluateKernel(F f, A a, B b, R* out, size_t n) {
+    const auto& config = parallelConfig();
+    if (n < config.threshold) {
+        kernels::evaluate(f, a, b, out, n);
+        return;
+    }
+    auto& pool = config.pool ? *config.pool : ThreadPool::global();
+    // Chunks of at least 4 KiB, so that no two threads write to the same
+    // cache line.
+    constexpr size_t ALIGNMENT = 1024;
+    pool.parallelFor(n, ALIGNMENT, [&](size_t begin, size_t end) {
+        kernels::evaluate(f, kernels::advance(a, begin), kernels::advance(b, begin), out + begin, end - begin);
+    });
 }
 
 template <typename F>
 Arg evaluateBinaryExpression(const Arg& arg1, const Arg& arg2, F f) {
     auto resultSize = getResultSize(arg1, arg2);
-    auto impl = [f, resultSize](const auto& a, const auto& b) {
-        return std::ranges::to<std::vector>(std::views::zip_transform(f, yieldAll(a, resultSize), yieldAll(b, resultSize)));
+    auto impl = [f, resultSize]<typename A, typename B>(const A& a, const B& b) -> Arg {
+        if constexpr (std::same_as<A, double> && std::same_as<B, double>) {
+            return Arg{static_cast<double>(f(a, b))};
+        } else {
+            auto res = ArgBufferPool::local().acquire(resultSize);
+            evaluateKernel(f, kernels::operand(a), kernels::operand(b), res.data(), resultSize);
+            if (res.size() == 1) {
+                auto val = res.front();
+                ArgBufferPool::local().release(std::move(res));
+                return Arg{val};
+            }
+            return res;
+        }
     };
-    auto res = std::visit(impl, arg1, arg2);
-    if (res.size() == 1) {
-        return Arg{res.front()};
-    } else {
+    return std::visit(impl, arg1, arg2);
+}
+
+// Hand the buffer of `arg`, if any, back to the `ArgBufferPool`.
+inline void recycle(Arg&& arg) {
+    if (auto vec = std::get_if<std::vector<double>>(&arg)) {
+        ArgBufferPool::local().release(std::move(*vec));
+    }
+}
+
+// Like above, but the operands are not read again. The result is computed in
+// place in the buffer of one of them, and the other buffer is recycled.
+template <typename F>
+Arg evaluateBinaryExpression(Arg&& arg1, Arg&& arg2, F f) {
+    auto resultSize = getResultSize(arg1, arg2);
+    auto inPlace = [&](Arg& target) {
+        auto vec = std::get_if<std::vector<double>>(&target);
+        return vec != nullptr && vec->size() == resultSize && resultSize > 1;
+    };
+    if (!inPlace(arg1) && !inPlace(arg2)) {
+        auto res = evaluateBinaryExpression(std::as_const(arg1), std::as_const(arg2), f);
+        recycle(std::move(arg1));
+        recycle(std::move(arg2));
         return res;
     }
+    auto& out = inPlace(arg1) ? std::get<std::vector<double>>(arg1) : std::get<std::vector<double>>(arg2);
+    auto impl = [f, resultSize, &out](const auto& a, const auto& b) {
+        evaluateKernel(f, kernels::operand(a), kernels::operand(b), out.data(), resultSize);
+    };
+    std::visit(impl, std::as_const(arg1), std::as_const(arg2));
+    if (&out == std::get_if<std::vector<double>>(&arg1)) {
+        recycle(std::move(arg2));
+        return std::move(arg1);
+    }
+    recycle(std::move(arg1));
+    return std::move(arg2);
 }
 
 template <typename F>
 Exp binaryExpression(Exp exp1, Exp exp2, F f = {}) {
-    for (const auto& [arg1, arg2] : std::views::zip(std::move(exp1), std::move(exp2))) {
-        co_yield evaluateBinaryExpression(arg1, arg2, f);
+    // The yielded `Arg`s are not used by anyone else, so their buffers can
+    // be reused.
+    for (auto&& [arg1, arg2] : std::views::zip(std::move(exp1), std::move(exp2))) {
+        co_yield evaluateBinaryExpression(std::move(arg1), std::move(arg2), f);
     }
 }
 
@@ -0,0 +1,353 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <utility>
+#include "./binary_expression.h"
+#include "./expression_sources.h"
+#include "./streaming_expression.h"
+#include "./typed_expression.h"
+
+// Count all heap allocations of the benchmark, `reportAllocations` reports
+// them per iteration.
+static std::atomic<size_t> numAllocations{0};
+
+void* operator new(size_t size) {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+struct AllocationCounter {
+    benchmark::State& state;
+    size_t start = numAllocations.load();
+
+    ~AllocationCounter() {
+        state.counters["allocs"] = benchmark::Counter(static_cast<double>(numAllocations.load() - start),
+                                                      benchmark::Counter::kAvgIterations);
+    }
+};
+
+// The evaluation via `zip_transform` that was used before the kernels, for
+// comparison.
+auto yieldAll(double val, size_t n) {
+    return std::views::repeat(val, n);
+}
+auto yieldAll(const std::vector<double>& vec, [[maybe_unused]] size_t n) -> decltype(auto) {
+    return vec;
+}
+
+template <typename F>
+Arg evaluateZipTransform(const Arg& arg1, const Arg& arg2, F f) {
+    auto resultSize = getResultSize(arg1, arg2);
+    auto impl = [f, resultSize](const auto& a, const auto& b) {
+        return std::ranges::to<std::vector>(std::views::zip_transform(f, yieldAll(a, resultSize), yieldAll(b, resultSize)));
+    };
+    auto res = std::visit(impl, arg1, arg2);
+    if (res.size() == 1) {
+        return Arg{res.front()};
+    } else {
+        return res;
+    }
+}
+
+static Arg column(size_t n, double offset) {
+    std::vector<double> vec(n);
+    for (size_t i = 0; i < n; ++i) {
+        vec[i] = static_cast<double>(i) + offset;
+    }
+    return vec;
+}
+
+template <typename F>
+static void BM_EvaluateVectorVector(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    auto a = column(n, 1.0);
+    auto b = column(n, 2.0);
+    for (auto _ : state) {
+        auto res = evaluateBinaryExpression(a, b, F{});
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Like above, but the result is handed back to the `ArgBufferPool` as it
+// happens in a chain of `binaryExpression`s.
+template <typename F>
+static void BM_EvaluateVectorVectorRecycled(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    auto a = column(n, 1.0);
+    auto b = column(n, 2.0);
+    for (auto _ : state) {
+        auto res = evaluateBinaryExpression(a, b, F{});
+        benchmark::DoNotOptimize(res);
+        recycle(std::move(res));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// The same as `BM_EvaluateVectorVectorRecycled`, but the kernel is looked up
+// at runtime.
+template <typename F>
+static void BM_EvaluateDispatch(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    auto a = column(n, 1.0);
+    auto b = column(n, 2.0);
+    auto op = runtime::opCodeOf<F>();
+    benchmark::DoNotOptimize(op);
+    for (auto _ : state) {
+        auto res = runtime::evaluateBinaryExpression(a, b, op);
+        benchmark::DoNotOptimize(res);
+        recycle(std::move(res));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Two scalars, which only shows the overhead of the dispatch per call.
+static void BM_EvaluateScalarScalarTemplated(benchmark::State& state){
+    Arg a{1.0};
+    Arg b{2.0};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a);
+        auto res = evaluateBinaryExpression(a, b, std::plus{});
+        benchmark::DoNotOptimize(res);
+    }
+}
+
+static void BM_EvaluateScalarScalarDispatch(benchmark::State& state){
+    Arg a{1.0};
+    Arg b{2.0};
+    auto op = runtime::OpCode::Plus;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a);
+        benchmark::DoNotOptimize(op);
+        auto res = runtime::evaluateBinaryExpression(a, b, op);
+        benchmark::DoNotOptimize(res);
+    }
+}
+
+template <typename F>
+static void BM_EvaluateScalarVector(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    Arg a{3.0};
+    auto b = column(n, 2.0);
+    for (auto _ : state) {
+        auto res = evaluateBinaryExpression(a, b, F{});
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <typename F>
+static void BM_EvaluateVectorScalar(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    auto a = column(n, 1.0);
+    Arg b{3.0};
+    for (auto _ : state) {
+        auto res = evaluateBinaryExpression(a, b, F{});
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <typename F>
+static void BM_EvaluateZipTransform(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    auto a = column(n, 1.0);
+    auto b = column(n, 2.0);
+    for (auto _ : state) {
+        auto res = evaluateZipTransform(a, b, F{});
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+template <typename T>
+static typed::Arg typedColumn(size_t n, T offset) {
+    std::vector<T> vec(n);
+    for (size_t i = 0; i < n; ++i) {
+        vec[i] = static_cast<T>(i % 1000) + offset;
+    }
+    return vec;
+}
+
+// `a + b` for columns of type `T`. The narrower `T`, the less memory is read
+// and written per element.
+template <typename T>
+static void BM_TypedEvaluate(benchmark::State& state){
+    const size_t n = state.range(0);
+    auto a = typedColumn<T>(n, 1);
+    auto b = typedColumn<T>(n, 2);
+    for (auto _ : state) {
+        auto res = typed::evaluateBinaryExpression(a, b, std::plus<>{});
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetBytesProcessed(state.iterations() * n * 3 * sizeof(T));
+}
+
+// `a < b` for columns of type `T`, the result is a packed bitmask.
+template <typename T>
+static void BM_TypedCompare(benchmark::State& state){
+    const size_t n = state.range(0);
+    auto a = typedColumn<T>(n, 1);
+    auto b = typedColumn<T>(n, 2);
+    for (auto _ : state) {
+        auto res = typed::evaluateBinaryExpression(a, b, std::less<>{});
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetBytesProcessed(state.iterations() * n * 2 * sizeof(T));
+}
+
+// `a + b` on a pool with `state.range(1)` threads, all results are computed
+// in parallel.
+static void BM_EvaluateParallel(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    ThreadPool pool{static_cast<size_t>(state.range(1))};
+    auto previous = std::exchange(parallelConfig(), ParallelConfig{&pool, 0});
+    auto a = column(n, 1.0);
+    auto b = column(n, 2.0);
+    for (auto _ : state) {
+        auto res = evaluateBinaryExpression(a, b, std::plus{});
+        benchmark::DoNotOptimize(res);
+        recycle(std::move(res));
+    }
+    parallelConfig() = previous;
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetBytesProcessed(state.iterations() * n * 3 * sizeof(double));
+}
+
+// A tree of depth 8 over columns of size `n`, 16 steps per iteration.
+static void BM_DeepTreeUnfused(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    constexpr size_t numSteps = 16;
+    for (auto _ : state) {
+        for (const auto& arg : unfusedTree<8>(n, numSteps)) {
+            benchmark::DoNotOptimize(arg);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n * numSteps);
+}
+
+static void BM_DeepTreeRuntime(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    constexpr size_t numSteps = 16;
+    for (auto _ : state) {
+        for (const auto& arg : runtimeTree(8, n, numSteps)) {
+            benchmark::DoNotOptimize(arg);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n * numSteps);
+}
+
+static void BM_DeepTreeFused(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    constexpr size_t numSteps = 16;
+    for (auto _ : state) {
+        for (const auto& arg : fused::evaluate(fusedTree<8>(n, numSteps))) {
+            benchmark::DoNotOptimize(arg);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n * numSteps);
+}
+
+// `(a + b) * 2` over generated columns, once materialised and once streamed
+// in chunks with constant memory.
+static void BM_MaterialisedExpression(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        auto a = column(n, 1.0);
+        auto b = column(n, 2.0);
+        auto res = evaluateBinaryExpression(evaluateBinaryExpression(a, b, std::plus{}), Arg{2.0}, std::multiplies{});
+        double sum = 0;
+        for (double v : std::get<std::vector<double>>(res)) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void BM_StreamingExpression(benchmark::State& state){
+    AllocationCounter allocationCounter{state};
+    const size_t n = state.range(0);
+    auto a = [](size_t i) { return static_cast<double>(i) + 1.0; };
+    auto b = [](size_t i) { return static_cast<double>(i) + 2.0; };
+    for (auto _ : state) {
+        auto sum = streaming::sum(streaming::binaryExpression(
+                streaming::binaryExpression(streaming::generate(n, a), streaming::generate(n, b), std::plus{}),
+                streaming::scalar(2.0), std::multiplies{}));
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void VectorSizes(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(10)->Range(1, 10'000'000);
+}
+
+static void TypedSizes(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(10)->Range(1000, 10'000'000);
+}
+
+using Min = std::remove_cvref_t<decltype(std::ranges::min)>;
+using Max = std::remove_cvref_t<decltype(std::ranges::max)>;
+
+BENCHMARK(BM_EvaluateZipTransform<std::plus<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorVector<std::plus<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorVectorRecycled<std::plus<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateDispatch<std::plus<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateScalarScalarTemplated);
+BENCHMARK(BM_EvaluateScalarScalarDispatch);
+BENCHMARK(BM_EvaluateScalarVector<std::plus<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorScalar<std::plus<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorVector<std::minus<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorVector<std::multiplies<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateZipTransform<std::divides<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorVector<std::divides<>>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateZipTransform<Min>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorVector<Min>)->Apply(VectorSizes);
+BENCHMARK(BM_EvaluateVectorVector<Max>)->Apply(VectorSizes);
+
+BENCHMARK(BM_TypedEvaluate<float>)->Apply(TypedSizes);
+BENCHMARK(BM_TypedEvaluate<double>)->Apply(TypedSizes);
+BENCHMARK(BM_TypedEvaluate<int32_t>)->Apply(TypedSizes);
+BENCHMARK(BM_TypedEvaluate<int64_t>)->Apply(TypedSizes);
+BENCHMARK(BM_TypedCompare<float>)->Apply(TypedSizes);
+BENCHMARK(BM_TypedCompare<double>)->Apply(TypedSizes);
+BENCHMARK(BM_TypedCompare<int32_t>)->Apply(TypedSizes);
+BENCHMARK(BM_TypedCompare<int64_t>)->Apply(TypedSizes);
+
+BENCHMARK(BM_EvaluateParallel)
+        ->ArgsProduct({{1 << 16, 1 << 20, 10'000'000}, benchmark::CreateRange(1, 64, 2)})
+        ->ArgNames({"n", "threads"})
+        ->UseRealTime();
+
+BENCHMARK(BM_DeepTreeUnfused)->RangeMultiplier(10)->Range(10, 1'000'000);
+BENCHMARK(BM_DeepTreeRuntime)->RangeMultiplier(10)->Range(10, 1'000'000);
+BENCHMARK(BM_DeepTreeFused)->RangeMultiplier(10)->Range(10, 1'000'000);
+
+BENCHMARK(BM_MaterialisedExpression)->RangeMultiplier(100)->Range(100, 100'000'000);
+BENCHMARK(BM_StreamingExpression)->RangeMultiplier(100)->Range(100, 100'000'000);
@@ -0,0 +1,166 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_EXPRESSION_KERNELS_H
+#define STD_GENERATOR_EXAMPLES_EXPRESSION_KERNELS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ranges>
+#include <type_traits>
+#include <vector>
+
+#if __has_include(<experimental/simd>) && !defined(EXPRESSION_KERNELS_NO_SIMD)
+#include <experimental/simd>
+#define EXPRESSION_KERNELS_HAVE_SIMD 1
+#endif
+
+// Tight loops over numeric columns for the operators that occur in
+// `binaryExpression`. Every operand is either a column or a scalar that is
+// broadcast, and the result is written straight into preallocated output.
+namespace kernels {
+
+// An operand that is a column of values.
+template <typename T>
+struct Column {
+    using value_type = T;
+    const T* data;
+
+    T at(size_t i) const { return data[i]; }
+};
+
+// An operand that is a single value, broadcast to the size of the result.
+template <typename T>
+struct Scalar {
+    using value_type = T;
+    T value;
+
+    T at(size_t) const { return value; }
+};
+
+template <typename T>
+Column<T> operand(const std::vector<T>& vec) { return {vec.data()}; }
+template <typename T>
+    requires std::is_arithmetic_v<T>
+Scalar<T> operand(T val) { return {val}; }
+
+// The operand for the elements from `offset` on.
+template <typename T>
+Column<T> advance(Column<T> col, size_t offset) { return {col.data + offset}; }
+template <typename T>
+Scalar<T> advance(Scalar<T> s, size_t) { return s; }
+
+// The operators with a dedicated SIMD kernel, `apply` is the operation on a
+// pack of values.
+template <typename F>
+struct SimdOp : std::false_type {};
+
+#define EXPRESSION_KERNELS_SIMD_OP(Functor, expr)               \
+    template <>                                                   \
+    struct SimdOp<Functor> : std::true_type {                     \
+        template <typename V>                                     \
+        static V apply(const V& a, const V& b) { return expr; } \
+    };
+
+EXPRESSION_KERNELS_SIMD_OP(std::plus<>, a + b)
+EXPRESSION_KERNELS_SIMD_OP(std::plus<double>, a + b)
+EXPRESSION_KERNELS_SIMD_OP(std::minus<>, a - b)
+EXPRESSION_KERNELS_SIMD_OP(std::minus<double>, a - b)
+EXPRESSION_KERNELS_SIMD_OP(std::multiplies<>, a * b)
+EXPRESSION_KERNELS_SIMD_OP(std::multiplies<double>, a * b)
+EXPRESSION_KERNELS_SIMD_OP(std::divides<>, a / b)
+EXPRESSION_KERNELS_SIMD_OP(std::divides<double>, a / b)
+#ifdef EXPRESSION_KERNELS_HAVE_SIMD
+EXPRESSION_KERNELS_SIMD_OP(std::remove_cvref_t<decltype(std::ranges::min)>, std::experimental::min(a, b))
+EXPRESSION_KERNELS_SIMD_OP(std::remove_cvref_t<decltype(std::ranges::max)>, std::experimental::max(a, b))
+#else
+EXPRESSION_KERNELS_SIMD_OP(std::remove_cvref_t<decltype(std::ranges::min)>, std::min(a, b))
+EXPRESSION_KERNELS_SIMD_OP(std::remove_cvref_t<decltype(std::ranges::max)>, std::max(a, b))
+#endif
+
+#undef EXPRESSION_KERNELS_SIMD_OP
+
+namespace detail {
+#ifdef EXPRESSION_KERNELS_HAVE_SIMD
+namespace stdx = std::experimental;
+template <typename R>
+using Pack = stdx::native_simd<R>;
+
+// Load and convert to the type `R` of the result.
+template <typename R, typename T>
+Pack<R> load(const Column<T>& col, size_t i) { return Pack<R>{col.data + i, stdx::element_aligned}; }
+template <typename R, typename T>
+Pack<R> load(const Scalar<T>& s, size_t) { return Pack<R>{static_cast<R>(s.value)}; }
+#endif
+
+template <typename R, typename F, typename A, typename B>
+void scalarLoop(F f, A a, B b, R* out, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        out[i] = static_cast<R>(f(static_cast<R>(a.at(i)), static_cast<R>(b.at(i))));
+    }
+}
+}  // namespace detail
+
+// Compute `out[i] = f(a[i], b[i])` for `i` in `[0, n)`. The operands are
+// converted to the type `R` of the result first, as for the usual arithmetic
+// conversions.
+template <typename F, typename A, typename B, typename R>
+void evaluate(F f, A a, B b, R* out, size_t n) {
+    if constexpr (SimdOp<F>::value) {
+#ifdef EXPRESSION_KERNELS_HAVE_SIMD
+        using Pack = detail::Pack<R>;
+        size_t i = 0;
+        for (; i + Pack::size() <= n; i += Pack::size()) {
+            SimdOp<F>::apply(detail::load<R>(a, i), detail::load<R>(b, i))
+                .copy_to(out + i, detail::stdx::element_aligned);
+        }
+        detail::scalarLoop(f, a, b, out, i, n);
+#else
+        detail::scalarLoop([](R x, R y) { return SimdOp<F>::apply(x, y); }, a, b, out, 0, n);
+#endif
+    } else {
+        detail::scalarLoop(f, a, b, out, 0, n);
+    }
+}
+
+// Compute the predicate `f(a[i], b[i])` for `i` in `[0, n)` into a packed
+// bitmask, bit `i % 64` of `out[i / 64]`. The bits past `n` are zero. The
+// operands are compared in their common type `C`.
+template <typename C, typename F, typename A, typename B>
+void compare(F f, A a, B b, uint64_t* out, size_t n) {
+    constexpr size_t BITS = 64;
+    for (size_t begin = 0; begin < n; begin += BITS) {
+        const size_t len = std::min(BITS, n - begin);
+        // One byte per element first, this loop is vectorized by the
+        // compiler, and then eight bytes at a time into a byte of the word.
+        alignas(BITS) uint8_t bytes[BITS] = {};
+        auto fill = [&](size_t numBytes) {
+            for (size_t j = 0; j < numBytes; ++j) {
+                bytes[j] = f(static_cast<C>(a.at(begin + j)), static_cast<C>(b.at(begin + j)));
+            }
+        };
+        // A constant trip count for all but the last word.
+        if (len == BITS) {
+            fill(BITS);
+        } else {
+            fill(len);
+        }
+        uint64_t word = 0;
+        for (size_t j = 0; j < BITS; j += 8) {
+            uint64_t eight;
+            std::memcpy(&eight, bytes + j, sizeof(eight));
+            // Moves the lowest bit of byte `k` to bit `56 + k`, for a
+            // little-endian `eight`.
+            word |= ((eight * 0x0102040810204080) >> 56) << j;
+        }
+        out[begin / BITS] = word;
+    }
+}
+
+}  // namespace kernels
+
+#endif  // STD_GENERATOR_EXAMPLES_EXPRESSION_KERNELS_H
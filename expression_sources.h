@@ -0,0 +1,85 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_EXPRESSION_SOURCES_H
+#define STD_GENERATOR_EXAMPLES_EXPRESSION_SOURCES_H
+
+#include <algorithm>
+
+#include "./binary_expression.h"
+#include "./fused_expression.h"
+#include "./mapped_file.h"
+#include "./runtime_expression.h"
+
+// A generator that yields `numSteps` columns of size `n`.
+inline Exp columnExp(size_t n, double offset, size_t numSteps) {
+    for (size_t step = 0; step < numSteps; ++step) {
+        auto vec = ArgBufferPool::local().acquire(n);
+        for (size_t i = 0; i < n; ++i) {
+            vec[i] = offset + static_cast<double>(i + step);
+        }
+        co_yield Arg{std::move(vec)};
+    }
+}
+
+// The binary column of `T`s in `file` as columns of `chunkSize` elements.
+// `Arg` always holds `double`s, so the chunks are converted into pooled
+// buffers, see `streaming::mappedColumn` for a leaf without a copy.
+template <typename T = double>
+Exp mappedColumnExp(MappedFile file, size_t chunkSize) {
+    file.adviseSequential();
+    const auto col = file.as<T>();
+    chunkSize = std::max(chunkSize, size_t{1});
+    for (size_t begin = 0; begin < col.size(); begin += chunkSize) {
+        const size_t len = std::min(chunkSize, col.size() - begin);
+        auto vec = ArgBufferPool::local().acquire(len);
+        std::copy_n(col.data() + begin, len, vec.data());
+        co_yield Arg{std::move(vec)};
+    }
+}
+
+inline Exp constantExp(double val) {
+    while (true) {
+        co_yield Arg{val};
+    }
+}
+
+// `(((c0 * c1 + 0.5) * c2 + 0.5) * c3 + 0.5) ...` with `Depth` columns,
+// evaluated node by node.
+template <size_t Depth>
+Exp unfusedTree(size_t n, size_t numSteps) {
+    if constexpr (Depth == 0) {
+        return columnExp(n, 0.0, numSteps);
+    } else {
+        auto product = binaryExpression(unfusedTree<Depth - 1>(n, numSteps), columnExp(n, Depth, numSteps), std::multiplies{});
+        return binaryExpression(std::move(product), constantExp(0.5), std::plus{});
+    }
+}
+
+// The same tree as `unfusedTree`, to be evaluated with `fused::evaluate`.
+template <size_t Depth>
+auto fusedTree(size_t n, size_t numSteps) {
+    if constexpr (Depth == 0) {
+        return fused::leaf(columnExp(n, 0.0, numSteps));
+    } else {
+        return fusedTree<Depth - 1>(n, numSteps) * fused::leaf(columnExp(n, Depth, numSteps)) + 0.5;
+    }
+}
+
+// The same tree as `unfusedTree`, but the depth is a runtime value and every
+// node is a `runtime::binaryExpression`.
+inline Exp runtimeTree(size_t depth, size_t n, size_t numSteps) {
+    std::vector<Exp> inputs;
+    inputs.push_back(columnExp(n, 0.0, numSteps));
+    auto plan = runtime::Plan::leaf(0);
+    for (size_t i = 1; i <= depth; ++i) {
+        inputs.push_back(columnExp(n, static_cast<double>(i), numSteps));
+        auto product = runtime::Plan::node(runtime::OpCode::Multiplies, std::move(plan), runtime::Plan::leaf(inputs.size() - 1));
+        inputs.push_back(constantExp(0.5));
+        plan = runtime::Plan::node(runtime::OpCode::Plus, std::move(product), runtime::Plan::leaf(inputs.size() - 1));
+    }
+    return runtime::build(plan, inputs);
+}
+
+#endif //STD_GENERATOR_EXAMPLES_EXPRESSION_SOURCES_H
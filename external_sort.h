@@ -0,0 +1,297 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_EXTERNAL_SORT_H
+#define STD_GENERATOR_EXAMPLES_EXTERNAL_SORT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "./any_generator.h"
+#include "./batched_generator.h"
+#include "./mapped_file.h"
+#include "./merge_sorted.h"
+#include "./thread_pool.h"
+
+namespace batched {
+
+struct external_sort_options {
+  /// The memory for the elements that are sorted in memory at once. The
+  /// input is cut into runs that fit into it, and the runs are spilled to
+  /// disk.
+  size_t memory_budget = size_t{256} << 20;
+  /// The threads that sort and write the runs, `ThreadPool::global()` if not
+  /// set.
+  ThreadPool *pool = nullptr;
+  /// The directory of the run files, the system's temp directory if empty.
+  std::string temp_dir{};
+};
+
+namespace detail {
+// A file that is removed when it goes out of scope.
+class temp_file {
+public:
+  explicit temp_file(std::string path) noexcept: M_path{std::move(path)} {}
+
+  temp_file(temp_file &&other) noexcept: M_path{std::exchange(other.M_path, {})} {}
+
+  temp_file &operator=(temp_file &&) = delete;
+
+  ~temp_file() {
+    if (!M_path.empty()) {
+      std::error_code ec;
+      std::filesystem::remove(M_path, ec);
+    }
+  }
+
+  const std::string &path() const noexcept { return M_path; }
+
+private:
+  std::string M_path;
+};
+
+// The number of the next run file of this process. Shared by the sorts of
+// all element types, so that concurrent sorts never pick the same name.
+inline std::atomic<size_t> run_counter{0};
+
+// A new file in `dir` with the raw bytes of `values`, throws
+// `std::system_error` if it can not be written.
+template<typename T>
+temp_file write_run(const std::string &dir, std::span<const T> values) {
+  auto path = (std::filesystem::path{dir} /
+               ("external_sort_" + std::to_string(::getpid()) + "_" +
+                std::to_string(run_counter.fetch_add(1, std::memory_order_relaxed)) + ".run")).string();
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    // The file is not ours, e.g. a leftover of another process, keep it.
+    throw std::system_error{errno, std::generic_category(), "Could not create " + path};
+  }
+  temp_file file{std::move(path)};
+  auto bytes = std::as_bytes(values);
+  while (!bytes.empty()) {
+    const ssize_t res = ::write(fd, bytes.data(), bytes.size());
+    if (res < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      const int err = errno;
+      ::close(fd);
+      throw std::system_error{err, std::generic_category(), "Could not write " + file.path()};
+    }
+    bytes = bytes.subspan(static_cast<size_t>(res));
+  }
+  ::close(fd);
+  return file;
+}
+
+// The elements of a run file. The file is mapped, so the pages that were
+// read can be dropped by the kernel, they are not part of the memory of
+// the process.
+template<typename T>
+generator<T> read_run(MappedFile file) {
+  file.adviseSequential();
+  auto sink = co_await get_batch_sink;
+  for (auto values = file.as<T>(); !values.empty();) {
+    const size_t n = std::min(sink.room(), values.size());
+    for (size_t i = 0; i < n; ++i) {
+      sink.emplace_back(values[i]);
+    }
+    values = values.subspan(n);
+    co_await sink.flush();
+  }
+}
+
+// Fill `buffer` with up to `n` elements of `input`, returns fewer only at
+// the end of the input. A short fill alone is not the end: e.g.
+// `custom::generator::next_batch` returns the elements before an exception
+// and throws on the next call, so the end is only certain after a fill of 0.
+template<typename Source, typename T>
+size_t fill_run(Source &input, T *buffer, size_t n) {
+  size_t filled = 0;
+  while (filled < n) {
+    const size_t k = input.M_fill(buffer + filled, n - filled);
+    if (k == 0) {
+      break;
+    }
+    filled += k;
+  }
+  return filled;
+}
+
+// The buffers of the runs that are filled by the consumer of the input
+// and sorted and written by the pool, and the files of the written runs.
+template<typename T>
+struct run_writer {
+  std::mutex M_mutex;
+  std::condition_variable M_changed;
+  std::vector<std::unique_ptr<T[]>> M_buffers;
+  std::vector<T *> M_free;
+  std::vector<temp_file> M_runs;
+  size_t M_num_running = 0;
+  std::exception_ptr M_except;
+
+  // The tasks refer to this state, wait for them also if the sort is
+  // abandoned.
+  ~run_writer() {
+    std::unique_lock lock{M_mutex};
+    M_changed.wait(lock, [this] { return M_num_running == 0; });
+  }
+
+  // A free buffer, throws the first exception of a task instead.
+  T *M_acquire() {
+    std::unique_lock lock{M_mutex};
+    M_changed.wait(lock, [this] { return !M_free.empty() || M_except; });
+    if (M_except) {
+      std::rethrow_exception(M_except);
+    }
+    auto *buffer = M_free.back();
+    M_free.pop_back();
+    return buffer;
+  }
+
+  void M_start() {
+    std::lock_guard lock{M_mutex};
+    ++M_num_running;
+  }
+
+  void M_release(T *buffer, std::optional<temp_file> run, std::exception_ptr except) {
+    // Notified under the lock, the waiter may destroy this state as soon as
+    // it sees that no task is running anymore.
+    std::lock_guard lock{M_mutex};
+    M_free.push_back(buffer);
+    if (run) {
+      M_runs.push_back(std::move(*run));
+    }
+    if (except && !M_except) {
+      M_except = except;
+    }
+    --M_num_running;
+    M_changed.notify_all();
+  }
+
+  // Wait until all runs are written, throws the first exception of a task.
+  void M_wait() {
+    std::unique_lock lock{M_mutex};
+    M_changed.wait(lock, [this] { return M_num_running == 0; });
+    if (M_except) {
+      std::rethrow_exception(M_except);
+    }
+  }
+};
+} // namespace detail
+
+/// Sort the elements of `source` by `comp` with a bounded amount of memory.
+/// The input is read in batches into buffers of `options.memory_budget`
+/// bytes in total. Every full buffer is sorted and written to a run file on
+/// the pool, while the next buffer is filled, so the sorting scales with the
+/// threads of the pool. The result merges the run files with
+/// `merge_sorted` while it is consumed, the files are mapped and removed
+/// before the first element is handed out. An input that fits into a single
+/// buffer is sorted without any files. `source` is anything that
+/// `any_generator<T>` accepts, e.g. a `custom::generator<T>` or a
+/// `batched::generator<T>`. `T` must be trivially copyable, the runs store
+/// its bytes. The sort is not stable.
+template<typename T, std::ranges::viewable_range R, typename Comp = std::ranges::less>
+generator<T>
+external_sort(R &&source, external_sort_options options = {}, Comp comp = {}) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return [](detail::any_source<std::views::all_t<R>, T> input, external_sort_options options,
+            Comp comp) -> generator<T> {
+    auto sink = co_await get_batch_sink;
+    auto &pool = options.pool ? *options.pool : ThreadPool::global();
+    if (options.temp_dir.empty()) {
+      options.temp_dir = std::filesystem::temp_directory_path().string();
+    }
+    // One buffer per worker of the pool that sorts, and one that is filled
+    // meanwhile. `size()` already counts the thread that fills.
+    const size_t num_buffers = pool.size();
+    const size_t run_size = std::max(options.memory_budget / sizeof(T) / num_buffers, size_t{1});
+
+    detail::run_writer<T> writer;
+    for (size_t i = 0; i < num_buffers; ++i) {
+      writer.M_buffers.push_back(std::make_unique_for_overwrite<T[]>(run_size));
+      writer.M_free.push_back(writer.M_buffers.back().get());
+    }
+    for (bool first = true;; first = false) {
+      T *buffer = writer.M_acquire();
+      const size_t n = detail::fill_run(input, buffer, run_size);
+      if (first && n < run_size) {
+        // Everything fits into memory.
+        std::sort(buffer, buffer + n, comp);
+        for (std::span<T> values{buffer, n}; !values.empty();) {
+          const size_t k = std::min(sink.room(), values.size());
+          for (size_t i = 0; i < k; ++i) {
+            sink.emplace_back(values[i]);
+          }
+          values = values.subspan(k);
+          co_await sink.flush();
+        }
+        co_return;
+      }
+      if (n == 0) {
+        break;
+      }
+      writer.M_start();
+      pool.submit([&writer, &options, &comp, n, buffer] {
+        std::optional<detail::temp_file> run;
+        std::exception_ptr except;
+        try {
+          std::sort(buffer, buffer + n, comp);
+          run.emplace(detail::write_run<T>(options.temp_dir, {buffer, n}));
+        } catch (...) {
+          except = std::current_exception();
+        }
+        writer.M_release(buffer, std::move(run), except);
+      });
+      if (n < run_size) {
+        break;
+      }
+    }
+    writer.M_wait();
+    writer.M_free.clear();
+    writer.M_buffers.clear();
+
+    std::vector<generator<T>> runs;
+    runs.reserve(writer.M_runs.size());
+    for (auto &file: writer.M_runs) {
+      runs.push_back(detail::read_run<T>(MappedFile{file.path()}));
+    }
+    // The mappings stay valid without the files.
+    writer.M_runs.clear();
+    for (auto &batch: merge_sorted(std::span{runs}, comp)) {
+      for (std::span<T> values{batch.data(), batch.size()}; !values.empty();) {
+        const size_t k = std::min(sink.room(), values.size());
+        for (size_t i = 0; i < k; ++i) {
+          sink.emplace_back(values[i]);
+        }
+        values = values.subspan(k);
+        co_await sink.flush();
+      }
+    }
+  }(detail::any_source<std::views::all_t<R>, T>{std::views::all(std::forward<R>(source))}, std::move(options),
+    std::move(comp));
+}
+
+} // namespace batched
+
+#endif //STD_GENERATOR_EXAMPLES_EXTERNAL_SORT_H
@@ -0,0 +1,109 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_FILE_SOURCES_H
+#define STD_GENERATOR_EXAMPLES_FILE_SOURCES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "./async_file.h"
+#include "./batched_generator.h"
+#include "./mapped_file.h"
+#include "./simple_generator.h"
+
+// Generators that read real files instead of computing their values. The
+// `MappedFile` is a parameter and not a local variable of the coroutines, so
+// it lives until the generator is destroyed, and everything that was yielded
+// stays valid until then, including the last batch of a `batched::generator`
+// that is handed out after the coroutine has finished.
+
+/// The number of bytes per chunk of `mapped_column_gen`.
+constexpr static size_t MAPPED_CHUNK_BYTES = 1 << 16;
+
+/// A binary column of `T`s (the raw bytes of a `T[]`), in chunks of
+/// `chunk_size` elements that point into the mapping. Nothing is copied.
+template<typename T>
+custom::generator<std::span<const T>> mapped_column_gen(MappedFile file,
+                                                        size_t chunk_size = MAPPED_CHUNK_BYTES / sizeof(T)) {
+    file.adviseSequential();
+    const auto col = file.as<T>();
+    chunk_size = std::max(chunk_size, size_t{1});
+    for (size_t begin = 0; begin < col.size(); begin += chunk_size) {
+        co_yield col.subspan(begin, std::min(chunk_size, col.size() - begin));
+    }
+}
+
+template<typename T>
+custom::generator<std::span<const T>> mapped_column_gen(const std::string& path,
+                                                        size_t chunk_size = MAPPED_CHUNK_BYTES / sizeof(T)) {
+    return mapped_column_gen<T>(MappedFile{path}, chunk_size);
+}
+
+/// The lines of a text file without the `'\n'`, in batches. A last line
+/// without a newline is also yielded.
+inline batched::generator<std::string_view> mapped_lines_gen(MappedFile file) {
+    file.adviseSequential();
+    const char* pos = reinterpret_cast<const char*>(file.data());
+    const char* const end = pos + file.size();
+    while (pos != end) {
+        const auto* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* lineEnd = newline ? newline : end;
+        co_yield std::string_view{pos, lineEnd};
+        pos = newline ? newline + 1 : end;
+    }
+}
+
+inline batched::generator<std::string_view> mapped_lines_gen(const std::string& path) {
+    return mapped_lines_gen(MappedFile{path});
+}
+
+/// The bytes of the file at `path` in chunks of `options.chunkBytes`, read
+/// by an `AsyncFileReader` with `options.inFlight` chunks read ahead. A chunk
+/// is valid until the generator is resumed, its buffer is then reused.
+inline custom::generator<std::span<const std::byte>> async_chunks_gen(std::string path,
+                                                                      AsyncReadOptions options = {}) {
+    AsyncFileReader reader{path, options};
+    for (auto chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+        co_yield chunk;
+    }
+}
+
+/// A binary column of `T`s like `mapped_column_gen`, but read with
+/// `async_chunks_gen`. `options.chunkBytes` must be a multiple of `sizeof(T)`,
+/// throws `std::invalid_argument` otherwise or if the size of the file is not
+/// a multiple of `sizeof(T)`. With `options.direct` it is rounded up to a
+/// multiple of both `sizeof(T)` and the alignment of the reads instead.
+template<typename T>
+custom::generator<std::span<const T>> async_column_gen(std::string path, AsyncReadOptions options = {}) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (options.direct) {
+        // The reader would round it up to its alignment only, then an
+        // element could be split between two chunks.
+        const size_t unit = std::lcm(AsyncFileReader::ALIGNMENT, sizeof(T));
+        options.chunkBytes = (std::max(options.chunkBytes, size_t{1}) + unit - 1) / unit * unit;
+    }
+    if (options.chunkBytes % sizeof(T) != 0) {
+        throw std::invalid_argument{"The chunk size " + std::to_string(options.chunkBytes) +
+                                    " is not a multiple of the element size " + std::to_string(sizeof(T))};
+    }
+    // The buffers are aligned for any `T`.
+    for (auto chunk : async_chunks_gen(std::move(path), options)) {
+        if (chunk.size() % sizeof(T) != 0) {
+            throw std::invalid_argument{"The size of the file is not a multiple of the element size " +
+                                        std::to_string(sizeof(T))};
+        }
+        co_yield std::span<const T>{reinterpret_cast<const T*>(chunk.data()), chunk.size() / sizeof(T)};
+    }
+}
+
+#endif //STD_GENERATOR_EXAMPLES_FILE_SOURCES_H
@@ -0,0 +1,186 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_FRAME_ALLOCATOR_H
+#define STD_GENERATOR_EXAMPLES_FRAME_ALLOCATOR_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace custom {
+
+/// A monotonic bump arena for coroutine frames. `deallocate` is a no-op, the
+/// memory is only handed back by `reset()` or the destructor, so this fits
+/// generators whose lifetime is bounded by a single request.
+/// Not thread-safe.
+class frame_arena {
+public:
+  static constexpr size_t default_block_size = 64 * 1024;
+
+  explicit frame_arena(size_t block_size = default_block_size)
+          : M_block_size{block_size} {}
+
+  frame_arena(const frame_arena &) = delete;
+  frame_arena &operator=(const frame_arena &) = delete;
+
+  void *allocate(size_t bytes, size_t align) {
+    auto cur = reinterpret_cast<uintptr_t>(M_cur);
+    auto aligned = (cur + align - 1) & ~(uintptr_t{align} - 1);
+    if (M_cur == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(M_end)) {
+      M_grow(bytes + align);
+      return allocate(bytes, align);
+    }
+    M_cur = reinterpret_cast<std::byte *>(aligned + bytes);
+    return reinterpret_cast<void *>(aligned);
+  }
+
+  void deallocate(void *, size_t) noexcept {}
+
+  /// Release all frames at once. Every generator that was allocated from this
+  /// arena must have been destroyed before.
+  void reset() noexcept {
+    // Keep the first block around, the next request will most likely need
+    // the same amount of memory.
+    if (M_blocks.empty()) {
+      return;
+    }
+    M_blocks.resize(1);
+    M_cur = M_blocks.front().data.get();
+    M_end = M_cur + M_blocks.front().size;
+  }
+
+private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  void M_grow(size_t min_size) {
+    auto size = std::max(M_block_size, min_size);
+    M_blocks.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+    M_cur = M_blocks.back().data.get();
+    M_end = M_cur + size;
+  }
+
+  size_t M_block_size;
+  std::vector<Block> M_blocks;
+  std::byte *M_cur = nullptr;
+  std::byte *M_end = nullptr;
+};
+
+/// A pool of coroutine frames with one free list per size class. All frames
+/// of the same coroutine have the same size, so a generator that is created
+/// and destroyed over and over again recycles the same frame. At most
+/// `max_free` frames per size class are kept, the others are freed.
+/// Not thread-safe.
+class frame_pool {
+public:
+  static constexpr size_t granularity = 64;
+  static constexpr size_t num_classes = 64;
+
+  frame_pool() = default;
+  explicit frame_pool(size_t max_free) : M_max_free{max_free} {}
+  frame_pool(const frame_pool &) = delete;
+  frame_pool &operator=(const frame_pool &) = delete;
+
+  ~frame_pool() {
+    for (auto &head : M_free) {
+      while (head != nullptr) {
+        ::operator delete(std::exchange(head, head->next), std::align_val_t{granularity});
+      }
+    }
+  }
+
+  void *allocate(size_t bytes, size_t align) {
+    auto cls = M_class(bytes);
+    if (cls >= num_classes || align > granularity) {
+      return ::operator new(bytes, std::align_val_t{std::max(align, granularity)});
+    }
+    if (auto node = M_free[cls]) {
+      M_free[cls] = node->next;
+      --M_num_free[cls];
+      return node;
+    }
+    return ::operator new((cls + 1) * granularity, std::align_val_t{granularity});
+  }
+
+  void deallocate(void *p, size_t bytes, size_t align) noexcept {
+    auto cls = M_class(bytes);
+    if (cls >= num_classes || align > granularity) {
+      ::operator delete(p, std::align_val_t{std::max(align, granularity)});
+      return;
+    }
+    if (M_num_free[cls] == M_max_free) {
+      ::operator delete(p, std::align_val_t{granularity});
+      return;
+    }
+    M_free[cls] = ::new(p) Node{M_free[cls]};
+    ++M_num_free[cls];
+  }
+
+private:
+  struct Node {
+    Node *next;
+  };
+
+  static size_t M_class(size_t bytes) noexcept {
+    return (std::max(bytes, size_t{1}) - 1) / granularity;
+  }
+
+  std::array<Node *, num_classes> M_free{};
+  std::array<size_t, num_classes> M_num_free{};
+  size_t M_max_free = std::numeric_limits<size_t>::max();
+};
+
+/// Allocator that refers to a `frame_arena` or a `frame_pool`. Pass it to a
+/// generator coroutine as `(std::allocator_arg, alloc, args...)`.
+template<typename T, typename Resource>
+class resource_allocator {
+public:
+  using value_type = T;
+
+  resource_allocator(Resource &resource) noexcept: M_resource{&resource} {}
+
+  template<typename U>
+  resource_allocator(const resource_allocator<U, Resource> &other) noexcept
+          : M_resource{other.resource()} {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(M_resource->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    if constexpr (requires { M_resource->deallocate(p, n * sizeof(T), alignof(T)); }) {
+      M_resource->deallocate(p, n * sizeof(T), alignof(T));
+    } else {
+      M_resource->deallocate(p, n * sizeof(T));
+    }
+  }
+
+  Resource *resource() const noexcept { return M_resource; }
+
+  template<typename U>
+  bool operator==(const resource_allocator<U, Resource> &other) const noexcept {
+    return M_resource == other.resource();
+  }
+
+private:
+  Resource *M_resource;
+};
+
+template<typename T = std::byte>
+using arena_allocator = resource_allocator<T, frame_arena>;
+
+template<typename T = std::byte>
+using pool_allocator = resource_allocator<T, frame_pool>;
+
+} // namespace custom
+
+#endif //STD_GENERATOR_EXAMPLES_FRAME_ALLOCATOR_H
@@ -0,0 +1,217 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_FUSED_EXPRESSION_H
+#define STD_GENERATOR_EXAMPLES_FUSED_EXPRESSION_H
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "./binary_expression.h"
+
+// Expression templates over `Exp` leaves. A whole tree of binary operations
+// is evaluated in a single pass per chunk of the output, without the
+// intermediate vectors that nested `binaryExpression`s allocate.
+namespace fused {
+
+// The number of output elements that are computed per pass over the tree.
+// Scalars are broadcast into a buffer of this size, so that every operand
+// is read with unit stride and the inner loop can be vectorized.
+constexpr static size_t CHUNK_SIZE = 256;
+
+template <typename E>
+concept Expression = requires(E& e, const E& ce, size_t i) {
+    { e.start() } -> std::same_as<bool>;
+    { e.next() } -> std::same_as<bool>;
+    { ce.size() } -> std::same_as<size_t>;
+    { ce.isScalar() } -> std::same_as<bool>;
+    e.seek(i);
+    { ce.at(i) } -> std::convertible_to<double>;
+};
+
+// A leaf that reads one `Arg` per step from an `Exp`.
+class Leaf {
+public:
+    explicit Leaf(Exp exp) : exp_{std::move(exp)} {}
+
+    // Start the generator and read the first `Arg`, false if there is none.
+    bool start() {
+        it_.emplace(exp_.begin());
+        return bind();
+    }
+
+    // Advance to the next `Arg`, false if the generator is exhausted.
+    bool next() {
+        // Nobody else reads the current `Arg`, so its buffer can be reused.
+        recycle(std::move(**it_));
+        ++*it_;
+        return bind();
+    }
+
+    size_t size() const { return size_; }
+    bool isScalar() const { return scalar_; }
+
+    // Read the chunk that starts at `begin`.
+    void seek(size_t begin) {
+        chunk_ = isScalar() ? broadcast_.data() : vector_ + begin;
+    }
+
+    double at(size_t i) const { return chunk_[i]; }
+
+private:
+    bool bind() {
+        if (*it_ == exp_.end()) {
+            return false;
+        }
+        // The yielded `Arg` stays alive until the generator is resumed.
+        const Arg& arg = **it_;
+        // An empty vector may have no `data()`, so it is not recognized by
+        // `vector_`.
+        scalar_ = std::holds_alternative<double>(arg);
+        if (auto vec = std::get_if<std::vector<double>>(&arg)) {
+            vector_ = vec->data();
+            size_ = vec->size();
+        } else {
+            vector_ = nullptr;
+            size_ = 1;
+            broadcast_.fill(std::get<double>(arg));
+        }
+        return true;
+    }
+
+    Exp exp_;
+    std::optional<std::ranges::iterator_t<Exp>> it_;
+    const double* vector_ = nullptr;
+    size_t size_ = 0;
+    bool scalar_ = true;
+    const double* chunk_ = nullptr;
+    std::array<double, CHUNK_SIZE> broadcast_;
+};
+
+// A constant that is the same for every step and never ends.
+class Constant {
+public:
+    explicit Constant(double value) { broadcast_.fill(value); }
+
+    bool start() { return true; }
+    bool next() { return true; }
+    size_t size() const { return 1; }
+    bool isScalar() const { return true; }
+    void seek(size_t) {}
+    double at(size_t i) const { return broadcast_[i]; }
+
+private:
+    std::array<double, CHUNK_SIZE> broadcast_;
+};
+
+template <Expression L, Expression R, typename F>
+class Binary {
+public:
+    Binary(L lhs, R rhs, F f) : lhs_{std::move(lhs)}, rhs_{std::move(rhs)}, f_{f} {}
+
+    bool start() { return lhs_.start() && rhs_.start(); }
+    bool next() { return lhs_.next() && rhs_.next(); }
+
+    // The same broadcasting as `::getResultSize`, a scalar takes the size of
+    // the other operand, which may be 0.
+    size_t size() const {
+        if (lhs_.isScalar()) {
+            return rhs_.size();
+        }
+        if (rhs_.isScalar()) {
+            return lhs_.size();
+        }
+        if (lhs_.size() != rhs_.size()) {
+            throw std::invalid_argument{"Operands of a fused expression have different sizes"};
+        }
+        return lhs_.size();
+    }
+
+    bool isScalar() const { return lhs_.isScalar() && rhs_.isScalar(); }
+
+    void seek(size_t begin) {
+        lhs_.seek(begin);
+        rhs_.seek(begin);
+    }
+
+    double at(size_t i) const { return f_(lhs_.at(i), rhs_.at(i)); }
+
+private:
+    L lhs_;
+    R rhs_;
+    [[no_unique_address]] F f_;
+};
+
+inline Leaf leaf(Exp exp) { return Leaf{std::move(exp)}; }
+inline Constant constant(double value) { return Constant{value}; }
+
+template <Expression L, Expression R, typename F>
+auto binary(L lhs, R rhs, F f = {}) {
+    return Binary<L, R, F>{std::move(lhs), std::move(rhs), f};
+}
+
+namespace detail {
+template <typename T>
+auto asExpression(T&& t) {
+    if constexpr (std::convertible_to<T, double>) {
+        return Constant{static_cast<double>(t)};
+    } else {
+        return std::forward<T>(t);
+    }
+}
+
+template <typename L, typename R>
+concept Operands = (Expression<std::remove_cvref_t<L>> && (Expression<std::remove_cvref_t<R>> || std::convertible_to<R, double>))
+                   || (std::convertible_to<L, double> && Expression<std::remove_cvref_t<R>>);
+}  // namespace detail
+
+#define FUSED_EXPRESSION_OPERATOR(op, Functor)                                               \
+    template <typename L, typename R>                                                        \
+        requires detail::Operands<L, R>                                                      \
+    auto operator op(L&& lhs, R&& rhs) {                                                     \
+        return binary(detail::asExpression(std::forward<L>(lhs)), detail::asExpression(std::forward<R>(rhs)), Functor{}); \
+    }
+
+FUSED_EXPRESSION_OPERATOR(+, std::plus<>)
+FUSED_EXPRESSION_OPERATOR(-, std::minus<>)
+FUSED_EXPRESSION_OPERATOR(*, std::multiplies<>)
+FUSED_EXPRESSION_OPERATOR(/, std::divides<>)
+
+#undef FUSED_EXPRESSION_OPERATOR
+
+// Evaluate the tree `expr`, one `Arg` per step of its leaves, like the
+// equivalent nesting of `binaryExpression`. The result is a vector whenever
+// one of the leaves is, also if it has 0 or 1 elements.
+template <Expression E>
+Exp evaluate(E expr) {
+    if (!expr.start()) {
+        co_return;
+    }
+    do {
+        if (expr.isScalar()) {
+            expr.seek(0);
+            co_yield Arg{expr.at(0)};
+            continue;
+        }
+        const size_t n = expr.size();
+        auto out = ArgBufferPool::local().acquire(n);
+        for (size_t begin = 0; begin < n; begin += CHUNK_SIZE) {
+            const size_t len = std::min(CHUNK_SIZE, n - begin);
+            expr.seek(begin);
+            double* chunk = out.data() + begin;
+            for (size_t i = 0; i < len; ++i) {
+                chunk[i] = expr.at(i);
+            }
+        }
+        co_yield Arg{std::move(out)};
+    } while (expr.next());
+}
+
+}  // namespace fused
+
+#endif  // STD_GENERATOR_EXAMPLES_FUSED_EXPRESSION_H
@@ -4,14 +4,27 @@
 #include <benchmark/benchmark.h>
 #include <generator>
 #include <numeric>
+#include <bit>
+#include <queue>
+#include <unordered_map>
+#include <cstdio>
 #include <iostream>
 #include "./simple_generator.h"
+#include "./frame_allocator.h"
+#include "./prefetch.h"
+#include "./pipeline.h"
+#include "./benchmark_counters.h"
+#include "./generator_combinators.h"
+#include "./merge_sorted.h"
+#include "./group_by.h"
+#include "./task.h"
 //#include "./batched_generator.h"
 #include "./IndirectIota.h"
 
 
 template <typename F>
 static void BM_IotaGenStd(benchmark::State& state){
+    CounterScope counters{state};
     auto gen = iota_gen_std(F{});
     auto it = gen.begin();
     R<F> res{};
@@ -23,6 +36,7 @@ static void BM_IotaGenStd(benchmark::State& state){
 
 template <typename F>
 static void BM_IotaGenSimple(benchmark::State& state){
+    CounterScope counters{state};
     auto gen = iota_gen_simple(F{});
     auto it = gen.begin();
     R<F> res{};
@@ -32,8 +46,68 @@ static void BM_IotaGenSimple(benchmark::State& state){
     }
 }
 
+template <typename F>
+static void BM_IotaGenNested(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_nested(state.range(0), F{});
+    auto it = gen.begin();
+    R<F> res{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize( res= std::move(*it));
+        ++it;
+    }
+}
+
+template <typename F>
+static void BM_IotaGenReyield(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_reyield(state.range(0), F{});
+    auto it = gen.begin();
+    R<F> res{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize( res= std::move(*it));
+        ++it;
+    }
+}
+
+template <typename F>
+static void BM_IotaGenSimpleCreate(benchmark::State& state){
+    CounterScope counters{state};
+    R<F> res{};
+    for (auto _ : state) {
+        auto gen = iota_gen_simple(F{});
+        benchmark::DoNotOptimize( res= std::move(*gen.begin()));
+    }
+}
+
+template <typename F>
+static void BM_IotaGenSimpleCreatePooled(benchmark::State& state){
+    CounterScope counters{state};
+    custom::frame_pool pool;
+    R<F> res{};
+    for (auto _ : state) {
+        auto gen = iota_gen_simple(std::allocator_arg, custom::pool_allocator<>{pool}, F{});
+        benchmark::DoNotOptimize( res= std::move(*gen.begin()));
+    }
+}
+
+template <typename F>
+static void BM_IotaGenSimpleCreateArena(benchmark::State& state){
+    CounterScope counters{state};
+    custom::frame_arena arena;
+    R<F> res{};
+    for (auto _ : state) {
+        {
+            auto gen = iota_gen_simple(std::allocator_arg, custom::arena_allocator<>{arena}, F{});
+            benchmark::DoNotOptimize( res= std::move(*gen.begin()));
+        }
+        arena.reset();
+    }
+}
+
 template <typename F>
 static void BM_IotaGenBatchedStdNested(benchmark::State& state){
+    CounterScope counters{state};
     auto gen = iota_gen_batched_std(F{});
     auto it = gen.begin();
     R<F> res{};
@@ -47,6 +121,7 @@ static void BM_IotaGenBatchedStdNested(benchmark::State& state){
 
 template <typename F>
 static void BM_IotaGenBatchedStdJoin(benchmark::State& state){
+    CounterScope counters{state};
     auto gen = iota_gen_batched_std(F{}) | std::views::join;
     auto it = gen.begin();
     R<F> res{};
@@ -56,14 +131,21 @@ static void BM_IotaGenBatchedStdJoin(benchmark::State& state){
     }
 }
 
+// The batched benchmarks take the size of a batch in bytes as their argument
+// (0 means the default size), the nested ones report the time per element.
 template <typename F>
 static void BM_IotaGenBatchedNested(benchmark::State& state){
+  CounterScope counters{state};
   auto gen = iota_gen_batched(F{});
+  if (state.range(0) != 0) {
+    gen.set_batch_bytes(state.range(0));
+  }
   auto it = gen.begin();
   R<F> res{};
-    size_t blubb = 0;
+    size_t numItems = 0;
   for (auto _ : state) {
-      benchmark::DoNotOptimize( blubb=(*it).back());
+      benchmark::DoNotOptimize((*it).back());
+      numItems += (*it).size();
       /*
     for (auto& el : *it) {
 
@@ -72,11 +154,31 @@ static void BM_IotaGenBatchedNested(benchmark::State& state){
       */
     ++it;
   }
+  state.SetItemsProcessed(numItems);
 }
 
 template <typename F>
 static void BM_IotaGenBatchedJoin(benchmark::State& state){
-    auto gen = iota_gen_batched(F{}) | std::views::join;
+    CounterScope counters{state};
+    auto batched = iota_gen_batched(F{});
+    if (state.range(0) != 0) {
+        batched.set_batch_bytes(state.range(0));
+    }
+    auto gen = std::move(batched) | std::views::join;
+    auto it = gen.begin();
+    R<F> res{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize( res=std::move(*it));
+        ++it;
+    }
+}
+
+template <typename F>
+static void BM_IotaGenBatchedJoinAdaptive(benchmark::State& state){
+    CounterScope counters{state};
+    auto batched = iota_gen_batched(F{});
+    batched.set_adaptive();
+    auto gen = std::move(batched) | std::views::join;
     auto it = gen.begin();
     R<F> res{};
     for (auto _ : state) {
@@ -85,8 +187,403 @@ static void BM_IotaGenBatchedJoin(benchmark::State& state){
     }
 }
 
+// The same as `BM_IotaGenSimple` and `BM_IotaGenBatchedNested`, but the
+// producer checks its stop token in every iteration.
+template <typename F>
+static void BM_IotaGenStoppable(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_stoppable(F{});
+    auto it = gen.begin();
+    R<F> res{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize( res= std::move(*it));
+        ++it;
+    }
+}
+
+template <typename F>
+static void BM_IotaGenBatchedStoppable(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_batched_stoppable(F{});
+    auto it = gen.begin();
+    size_t numItems = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize((*it).back());
+        numItems += (*it).size();
+        ++it;
+    }
+    state.SetItemsProcessed(numItems);
+}
+
+// Create a generator, take a few elements and stop it, e.g. for a
+// `std::views::take` consumer.
+static void BM_IotaGenTakeStop(benchmark::State& state){
+    CounterScope counters{state};
+    size_t res = 0;
+    for (auto _ : state) {
+        auto gen = iota_gen_stoppable();
+        for (auto el : gen) {
+            res += el;
+            if (el == 8) {
+                gen.request_stop();
+            }
+        }
+        benchmark::DoNotOptimize(res);
+    }
+}
+
+// The unmodified `iota_gen_simple` consumed in batches of `state.range(0)`
+// elements via `next_batch`, the time is per element.
+template <typename F>
+static void BM_IotaGenSimpleNextBatch(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_simple(F{});
+    std::vector<R<F>> batch(state.range(0));
+    size_t numItems = 0;
+    for (auto _ : state) {
+        numItems += gen.next_batch(batch);
+        benchmark::DoNotOptimize(batch.back());
+    }
+    state.SetItemsProcessed(numItems);
+}
+
+template <typename F>
+static void BM_IotaGenNestedNextBatch(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_nested(16, F{});
+    std::vector<R<F>> batch(state.range(0));
+    size_t numItems = 0;
+    for (auto _ : state) {
+        numItems += gen.next_batch(batch);
+        benchmark::DoNotOptimize(batch.back());
+    }
+    state.SetItemsProcessed(numItems);
+}
+
+// `batched::join` instead of `std::views::join`, the same loop as
+// `BM_IotaGenBatchedJoin`.
+template <typename F>
+static void BM_IotaGenBatchedNativeJoin(benchmark::State& state){
+    CounterScope counters{state};
+    auto batched = iota_gen_batched(F{});
+    if (state.range(0) != 0) {
+        batched.set_batch_bytes(state.range(0));
+    }
+    auto gen = batched::join(std::move(batched));
+    auto it = gen.begin();
+    R<F> res{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize( res=std::move(*it));
+        ++it;
+    }
+}
+
+// Two iota sources zipped, with `std::views::zip` and with the combinators
+// of `generator_combinators.h`. The time is per pair.
+static void BM_ZipStd(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = std::views::zip(iota_gen_simple(), iota_gen_simple());
+    auto it = gen.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        auto [a, b] = *it;
+        benchmark::DoNotOptimize(res += a + b);
+        ++it;
+    }
+}
+
+static void BM_ZipCustom(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = custom::zip(iota_gen_simple(), iota_gen_simple());
+    auto it = gen.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        auto [a, b] = *it;
+        benchmark::DoNotOptimize(res += a + b);
+        ++it;
+    }
+}
+
+static void BM_ZipBatchedStd(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = std::views::zip(iota_gen_batched() | std::views::join, iota_gen_batched() | std::views::join);
+    auto it = gen.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        auto [a, b] = *it;
+        benchmark::DoNotOptimize(res += a + b);
+        ++it;
+    }
+}
+
+static void BM_ZipBatched(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = batched::join(batched::zip(iota_gen_batched(), iota_gen_batched()));
+    auto it = gen.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        auto [a, b] = *it;
+        benchmark::DoNotOptimize(res += a + b);
+        ++it;
+    }
+}
+
+// The zipped batches consumed as a whole, without flattening them.
+static void BM_ZipBatchedNested(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = batched::zip(iota_gen_batched(), iota_gen_batched());
+    auto it = gen.begin();
+    size_t numItems = 0;
+    for (auto _ : state) {
+        size_t res = 0;
+        for (auto [a, b] : *it) {
+            res += a + b;
+        }
+        benchmark::DoNotOptimize(res);
+        numItems += (*it).size();
+        ++it;
+    }
+    state.SetItemsProcessed(numItems);
+}
+
+// Four finite iota sources one after the other, with `std::views::join`
+// over a vector of the generators and with `concat`.
+static constexpr size_t CONCAT_PART_SIZE = 1 << 16;
+
+static void BM_ConcatStdJoin(benchmark::State& state){
+    CounterScope counters{state};
+    size_t res = 0;
+    while (state.KeepRunningBatch(4 * CONCAT_PART_SIZE)) {
+        std::vector<custom::generator<size_t>> parts;
+        for (size_t i = 0; i < 4; ++i) {
+            parts.push_back(iota_gen_simple_n(CONCAT_PART_SIZE));
+        }
+        for (auto el : parts | std::views::join) {
+            benchmark::DoNotOptimize(res += el);
+        }
+    }
+}
+
+static void BM_ConcatCustom(benchmark::State& state){
+    CounterScope counters{state};
+    size_t res = 0;
+    while (state.KeepRunningBatch(4 * CONCAT_PART_SIZE)) {
+        for (auto el : custom::concat(iota_gen_simple_n(CONCAT_PART_SIZE), iota_gen_simple_n(CONCAT_PART_SIZE),
+                                      iota_gen_simple_n(CONCAT_PART_SIZE), iota_gen_simple_n(CONCAT_PART_SIZE))) {
+            benchmark::DoNotOptimize(res += el);
+        }
+    }
+}
+
+static void BM_ConcatBatched(benchmark::State& state){
+    CounterScope counters{state};
+    size_t res = 0;
+    while (state.KeepRunningBatch(4 * CONCAT_PART_SIZE)) {
+        for (auto el : batched::join(batched::concat(iota_gen_batched_n(CONCAT_PART_SIZE),
+                                                     iota_gen_batched_n(CONCAT_PART_SIZE),
+                                                     iota_gen_batched_n(CONCAT_PART_SIZE),
+                                                     iota_gen_batched_n(CONCAT_PART_SIZE)))) {
+            benchmark::DoNotOptimize(res += el);
+        }
+    }
+}
+
+// Merge the even and the odd numbers. There is no lazy merge in the
+// standard library, the baseline compares the fronts of two generators.
+auto timesTwo = [](size_t i) { return 2 * i; };
+auto timesTwoPlusOne = [](size_t i) { return 2 * i + 1; };
+
+static void BM_MergeIterators(benchmark::State& state){
+    CounterScope counters{state};
+    auto evens = iota_gen_simple(timesTwo);
+    auto odds = iota_gen_simple(timesTwoPlusOne);
+    auto it1 = evens.begin();
+    auto it2 = odds.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        if (*it2 < *it1) {
+            benchmark::DoNotOptimize(res += *it2);
+            ++it2;
+        } else {
+            benchmark::DoNotOptimize(res += *it1);
+            ++it1;
+        }
+    }
+}
+
+static void BM_MergeBatched(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = batched::join(batched::merge(iota_gen_batched(timesTwo), iota_gen_batched(timesTwoPlusOne)));
+    auto it = gen.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(res += *it);
+        ++it;
+    }
+}
+
+// `state.range(0)` interleaved sources merged by a tree of two-way merges.
+static void BM_MergeBatchedTree(benchmark::State& state){
+    CounterScope counters{state};
+    const size_t k = state.range(0);
+    std::vector<batched::generator<size_t>> inputs;
+    for (size_t j = 0; j < k; ++j) {
+        inputs.push_back(iota_gen_batched([j, k](size_t i) { return i * k + j; }));
+    }
+    auto gen = batched::join(batched::merge(std::move(inputs)));
+    auto it = gen.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(res += *it);
+        ++it;
+    }
+}
+
+// Merge `state.range(0)` sorted inputs of `MergeInput<T>` that interleave
+// perfectly, so consecutive elements come from different inputs. The time
+// is per element, including the production of the inputs.
+static constexpr size_t MERGE_SIZE = 1 << 20;
+
+template <typename T>
+struct MergeInput;
+
+template <>
+struct MergeInput<size_t> {
+    size_t operator()(size_t i) const { return i; }
+};
+
+template <>
+struct MergeInput<std::string> {
+    // Zero-padded, so that the strings sort like the numbers.
+    std::string operator()(size_t i) const {
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "%020zu", i);
+        return buf;
+    }
+};
+
+template <typename T>
+static auto mergeInputFn(size_t j, size_t k) {
+    return [j, k](size_t i) { return MergeInput<T>{}(i * k + j); };
+}
+
+// The per-element approach: a `std::priority_queue` of the fronts of the
+// inputs, one resumption of an input per element.
+template <typename T>
+static void BM_MergeSortedPriorityQueue(benchmark::State& state){
+    CounterScope counters{state};
+    const size_t k = state.range(0);
+    size_t res = 0;
+    while (state.KeepRunningBatch(MERGE_SIZE / k * k)) {
+        std::vector<custom::generator<T>> inputs;
+        for (size_t j = 0; j < k; ++j) {
+            inputs.push_back(iota_gen_simple_n(MERGE_SIZE / k, mergeInputFn<T>(j, k)));
+        }
+        using Iterator = decltype(inputs.front().begin());
+        std::vector<Iterator> its;
+        using Entry = std::pair<T, size_t>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+        for (size_t j = 0; j < k; ++j) {
+            its.push_back(inputs[j].begin());
+            if (its[j] != std::default_sentinel) {
+                queue.emplace(*its[j], j);
+            }
+        }
+        while (!queue.empty()) {
+            auto j = queue.top().second;
+            res += sizeof(queue.top().first);
+            queue.pop();
+            if (++its[j] != std::default_sentinel) {
+                queue.emplace(*its[j], j);
+            }
+        }
+        benchmark::DoNotOptimize(res);
+    }
+}
+
+template <typename T>
+static void BM_MergeSortedLoserTree(benchmark::State& state){
+    CounterScope counters{state};
+    const size_t k = state.range(0);
+    size_t res = 0;
+    while (state.KeepRunningBatch(MERGE_SIZE / k * k)) {
+        std::vector<batched::generator<T>> inputs;
+        for (size_t j = 0; j < k; ++j) {
+            inputs.push_back(iota_gen_batched_n(MERGE_SIZE / k, mergeInputFn<T>(j, k)));
+        }
+        for (auto& batch : batched::merge_sorted(std::span{inputs})) {
+            benchmark::DoNotOptimize(batch.back());
+            res += batch.size();
+        }
+    }
+    benchmark::DoNotOptimize(res);
+}
+
+// The same with `custom::generator` inputs that are read with `next_batch`.
+template <typename T>
+static void BM_MergeSortedLoserTreeCustom(benchmark::State& state){
+    CounterScope counters{state};
+    const size_t k = state.range(0);
+    size_t res = 0;
+    while (state.KeepRunningBatch(MERGE_SIZE / k * k)) {
+        std::vector<custom::generator<T>> inputs;
+        for (size_t j = 0; j < k; ++j) {
+            inputs.push_back(iota_gen_simple_n(MERGE_SIZE / k, mergeInputFn<T>(j, k)));
+        }
+        for (auto& batch : batched::merge_sorted(std::span{inputs})) {
+            benchmark::DoNotOptimize(batch.back());
+            res += batch.size();
+        }
+    }
+    benchmark::DoNotOptimize(res);
+}
+
+// Group `GROUP_BY_SIZE` elements by one of `state.range(0)` distinct keys
+// (a power of two) and aggregate their values. The keys are scattered, so
+// the hash table is accessed at random.
+static constexpr size_t GROUP_BY_SIZE = 1 << 22;
+
+static auto groupKeyFn(size_t cardinality) {
+    const int shift = 64 - std::countr_zero(cardinality);
+    return [shift](size_t i) -> size_t { return i * 0x9E3779B97F4A7C15ull >> shift; };
+}
+
+// The per-element baseline: `iota_gen_simple` into a `std::unordered_map`.
+static void BM_GroupByUnorderedMap(benchmark::State& state){
+    CounterScope counters{state};
+    auto key = groupKeyFn(state.range(0));
+    while (state.KeepRunningBatch(GROUP_BY_SIZE)) {
+        std::unordered_map<size_t, batched::group_aggregate<size_t>> groups;
+        for (auto i : iota_gen_simple_n(GROUP_BY_SIZE)) {
+            groups[key(i)].add(i);
+        }
+        benchmark::DoNotOptimize(groups.size());
+    }
+}
+
+// `batched::group_by_aggregate` with `state.range(1)` threads.
+static void BM_GroupByAggregate(benchmark::State& state){
+    CounterScope counters{state};
+    auto key = groupKeyFn(state.range(0));
+    ThreadPool pool{static_cast<size_t>(state.range(1))};
+    while (state.KeepRunningBatch(GROUP_BY_SIZE)) {
+        auto groups = batched::group_by_aggregate(iota_gen_batched_n(GROUP_BY_SIZE), key, std::identity{},
+                                                  {.pool = &pool});
+        benchmark::DoNotOptimize(groups.size());
+    }
+}
+
+static void FanInSweep(benchmark::internal::Benchmark* b) {
+    b->ArgName("fan_in")->RangeMultiplier(4)->Range(2, 1024);
+}
+
+static void BatchBytesSweep(benchmark::internal::Benchmark* b) {
+    b->Arg(0)->RangeMultiplier(4)->Range(64, 256 << 10);
+}
+
 template <typename F>
 static void BM_Iota(benchmark::State& state){
+    CounterScope counters{state};
     auto gen = std::views::iota(size_t{0}) | std::views::transform(F{});
     auto it = gen.begin();
     R<F> res{};
@@ -97,6 +594,7 @@ static void BM_Iota(benchmark::State& state){
 }
 
 static void BM_IndirectIota(benchmark::State& state){
+    CounterScope counters{state};
     auto gen = IndirectIota{};
     size_t res = 0;
     for (auto _ : state) {
@@ -105,6 +603,7 @@ static void BM_IndirectIota(benchmark::State& state){
 }
 
 static void BM_VirtualIota(benchmark::State& state){
+    CounterScope counters{state};
     auto ptr = makeVirtualIota();
     auto& gen = *ptr;
     size_t res = 0;
@@ -113,7 +612,21 @@ static void BM_VirtualIota(benchmark::State& state){
     }
 }
 
+// A type-erased source, chosen at runtime like `makeVirtualIota`, but called
+// once per batch instead of once per element.
+static void BM_AnyGeneratorIota(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = makeAnyIota(state.range(0));
+    auto it = gen.begin();
+    size_t res = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize( res+= *it);
+        ++it;
+    }
+}
+
 static void BM_IndirectFunction(benchmark::State& state){
+  CounterScope counters{state};
   size_t res = 0;
   for (auto _ : state) {
     benchmark::DoNotOptimize( res+= indirectFunction());
@@ -137,20 +650,225 @@ auto toString = [](size_t i) {
 };
 
 using ToString = decltype(toString);
-//using ToString = decltype(toNoCopy);
+using ToNoCopy = decltype(toNoCopy);
+
+// Consumer work that costs about as much as `toString` does on the producer
+// side.
+auto fromString = [](const std::string& s) {
+    return std::stoul(s) + std::hash<std::string>{}(s);
+};
+
+// Produce with `iota_gen_batched(toString)` and consume with `fromString`,
+// either on the same thread or with the producer on a worker thread.
+static void BM_ProduceConsumeSerial(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_batched(toString) | std::views::join;
+    auto it = gen.begin();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fromString(*it));
+        ++it;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_ProduceConsumePrefetch(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = batched::prefetch(iota_gen_batched(toString), state.range(0)) | std::views::join;
+    auto it = gen.begin();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fromString(*it));
+        ++it;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_ProduceConsumePrefetchStd(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = batched::prefetch(batched::as_batches(iota_gen_batched_std(toString)), state.range(0)) | std::views::join;
+    auto it = gen.begin();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fromString(*it));
+        ++it;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// A transform that is expensive enough to be spread across threads.
+auto toStringExpensive = [](size_t i) {
+    auto s = std::to_string(i);
+    for (size_t k = 0; k < 16; ++k) {
+        s = std::to_string(std::hash<std::string>{}(s));
+    }
+    return s;
+};
+
+static void BM_MapSerial(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_batched(toStringExpensive) | std::views::join;
+    auto it = gen.begin();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(*it);
+        ++it;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// `toStringExpensive` on `state.range(0)` threads, in the order of the
+// source if `state.range(1)` is set.
+static void BM_ParallelMap(benchmark::State& state){
+    CounterScope counters{state};
+    auto gen = iota_gen_batched() | batched::parallel_map(toStringExpensive, state.range(0), state.range(1)) |
+               std::views::join;
+    auto it = gen.begin();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(*it);
+        ++it;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// A filter followed by a map, both on `state.range(0)` threads.
+static void BM_ParallelFilterMap(benchmark::State& state){
+    CounterScope counters{state};
+    const size_t threads = state.range(0);
+    auto gen = iota_gen_batched() | batched::parallel_filter([](size_t i) { return i % 3 != 0; }, threads) |
+               batched::parallel_map(toStringExpensive, threads) | std::views::join;
+    auto it = gen.begin();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(*it);
+        ++it;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// The recursive Fibonacci numbers, as the serial baseline of the task
+// benchmarks.
+static size_t fibSerial(size_t n) { return n < 2 ? n : fibSerial(n - 1) + fibSerial(n - 2); }
+
+// The number of calls of `fibSerial(n)`.
+static size_t fibCalls(size_t n) { return n < 2 ? 1 : 1 + fibCalls(n - 1) + fibCalls(n - 2); }
+
+// The same with one task per call, every call forks its two subcalls with
+// `when_all`, so the work is stolen at every level of the recursion.
+static custom::task<size_t> fibTask(size_t n) {
+    if (n < 2) {
+        co_return n;
+    }
+    auto [a, b] = co_await custom::when_all(fibTask(n - 1), fibTask(n - 2));
+    co_return a + b;
+}
+
+static void BM_FibSerial(benchmark::State& state){
+    CounterScope counters{state};
+    const size_t n = state.range(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fibSerial(n));
+    }
+    state.SetItemsProcessed(state.iterations() * fibCalls(n));
+}
 
-BENCHMARK(BM_IotaGenBatchedNested<std::identity>);
+// `fibTask(state.range(0))` on `state.range(1)` threads, the items are the
+// tasks.
+static void BM_FibTask(benchmark::State& state){
+    CounterScope counters{state};
+    const size_t n = state.range(0);
+    custom::task_scheduler scheduler{static_cast<size_t>(state.range(1))};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scheduler.sync_wait(fibTask(n)));
+    }
+    state.SetItemsProcessed(state.iterations() * fibCalls(n));
+}
+
+// Many independent tasks of a few microseconds each, to see how the
+// throughput scales with the number of threads.
+static custom::task<size_t> fibSerialTask(size_t n) { co_return fibSerial(n); }
+
+static void BM_TaskThroughput(benchmark::State& state){
+    CounterScope counters{state};
+    static constexpr size_t NUM_TASKS = 1024;
+    custom::task_scheduler scheduler{static_cast<size_t>(state.range(0))};
+    for (auto _ : state) {
+        std::vector<custom::task<size_t>> tasks;
+        tasks.reserve(NUM_TASKS);
+        for (size_t i = 0; i < NUM_TASKS; ++i) {
+            tasks.push_back(fibSerialTask(18));
+        }
+        benchmark::DoNotOptimize(scheduler.sync_wait(custom::when_all(std::move(tasks))));
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_TASKS);
+}
+
+BENCHMARK(BM_IotaGenBatchedNested<std::identity>)->Apply(BatchBytesSweep);
 BENCHMARK(BM_IotaGenStd<std::identity>);
 BENCHMARK(BM_IotaGenSimple<std::identity>);
+BENCHMARK(BM_IotaGenNested<std::identity>)->DenseRange(0, 16, 4);
+BENCHMARK(BM_IotaGenReyield<std::identity>)->DenseRange(0, 16, 4);
 BENCHMARK(BM_Iota<std::identity>);
+BENCHMARK(BM_IotaGenSimpleCreate<std::identity>);
+BENCHMARK(BM_IotaGenSimpleCreatePooled<std::identity>);
+BENCHMARK(BM_IotaGenSimpleCreateArena<std::identity>);
 BENCHMARK(BM_IndirectIota);
 BENCHMARK(BM_VirtualIota);
+BENCHMARK(BM_AnyGeneratorIota)->DenseRange(0, 2);
 BENCHMARK(BM_IndirectFunction);
 BENCHMARK(BM_IotaGenBatchedStdJoin<std::identity>);
 BENCHMARK(BM_IotaGenBatchedStdNested<std::identity>);
-BENCHMARK(BM_IotaGenBatchedJoin<std::identity>);
+BENCHMARK(BM_IotaGenBatchedJoin<std::identity>)->Apply(BatchBytesSweep);
+BENCHMARK(BM_IotaGenBatchedJoinAdaptive<std::identity>);
+BENCHMARK(BM_IotaGenBatchedNativeJoin<std::identity>)->Apply(BatchBytesSweep);
+BENCHMARK(BM_IotaGenStoppable<std::identity>);
+BENCHMARK(BM_IotaGenBatchedStoppable<std::identity>);
+BENCHMARK(BM_IotaGenTakeStop);
+BENCHMARK(BM_IotaGenSimpleNextBatch<std::identity>)->RangeMultiplier(8)->Range(8, 8 << 12);
+BENCHMARK(BM_IotaGenNestedNextBatch<std::identity>)->Arg(1024);
 
 BENCHMARK(BM_IotaGenStd<ToString>);
 BENCHMARK(BM_IotaGenSimple<ToString>);
-BENCHMARK(BM_IotaGenBatchedJoin<ToString>);
+BENCHMARK(BM_IotaGenBatchedJoin<ToString>)->Apply(BatchBytesSweep);
+BENCHMARK(BM_IotaGenBatchedJoinAdaptive<ToString>);
+BENCHMARK(BM_IotaGenSimpleNextBatch<ToString>)->Arg(1024);
 BENCHMARK(BM_Iota<ToString>);
+BENCHMARK(BM_IotaGenBatchedNested<ToString>)->Arg(0);
+BENCHMARK(BM_IotaGenBatchedStdNested<ToString>);
+
+BENCHMARK(BM_IotaGenSimple<ToNoCopy>);
+BENCHMARK(BM_IotaGenBatchedNested<ToNoCopy>)->Arg(0);
+BENCHMARK(BM_IotaGenBatchedStdNested<ToNoCopy>);
+BENCHMARK(BM_IotaGenBatchedJoin<ToNoCopy>)->Arg(0);
+BENCHMARK(BM_IotaGenBatchedStdJoin<ToNoCopy>);
+BENCHMARK(BM_IotaGenBatchedNativeJoin<ToNoCopy>)->Arg(0);
+
+BENCHMARK(BM_ZipStd);
+BENCHMARK(BM_ZipCustom);
+BENCHMARK(BM_ZipBatchedStd);
+BENCHMARK(BM_ZipBatched);
+BENCHMARK(BM_ZipBatchedNested);
+BENCHMARK(BM_ConcatStdJoin);
+BENCHMARK(BM_ConcatCustom);
+BENCHMARK(BM_ConcatBatched);
+BENCHMARK(BM_MergeIterators);
+BENCHMARK(BM_MergeBatched);
+BENCHMARK(BM_MergeBatchedTree)->RangeMultiplier(4)->Range(2, 32);
+
+BENCHMARK(BM_MergeSortedPriorityQueue<size_t>)->Apply(FanInSweep);
+BENCHMARK(BM_MergeSortedLoserTree<size_t>)->Apply(FanInSweep);
+BENCHMARK(BM_MergeSortedLoserTreeCustom<size_t>)->Apply(FanInSweep);
+BENCHMARK(BM_MergeSortedPriorityQueue<std::string>)->Apply(FanInSweep);
+BENCHMARK(BM_MergeSortedLoserTree<std::string>)->Apply(FanInSweep);
+BENCHMARK(BM_MergeSortedLoserTreeCustom<std::string>)->Apply(FanInSweep);
+
+BENCHMARK(BM_GroupByUnorderedMap)->ArgName("keys")->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_GroupByAggregate)->ArgsProduct({{16, 256, 4096, 1 << 16, 1 << 20}, {1, 4}})
+        ->ArgNames({"keys", "threads"})->UseRealTime();
+
+BENCHMARK(BM_ProduceConsumeSerial)->UseRealTime();
+BENCHMARK(BM_ProduceConsumePrefetch)->Arg(2)->Arg(4)->Arg(16)->UseRealTime();
+BENCHMARK(BM_ProduceConsumePrefetchStd)->Arg(4)->UseRealTime();
+
+BENCHMARK(BM_MapSerial)->UseRealTime();
+BENCHMARK(BM_ParallelMap)->ArgsProduct({{1, 2, 4, 8, 16}, {0, 1}})->ArgNames({"threads", "ordered"})->UseRealTime();
+BENCHMARK(BM_ParallelFilterMap)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
+
+BENCHMARK(BM_FibSerial)->Arg(25);
+BENCHMARK(BM_FibTask)->ArgsProduct({{25}, {1, 2, 4, 8}})->ArgNames({"n", "threads"})->UseRealTime();
+BENCHMARK(BM_TaskThroughput)->ArgName("threads")->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
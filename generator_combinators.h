@@ -0,0 +1,291 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_GENERATOR_COMBINATORS_H
+#define STD_GENERATOR_EXAMPLES_GENERATOR_COMBINATORS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "./batched_generator.h"
+#include "./simple_generator.h"
+
+// Combinators for the generators of this project that replace
+// `std::views::zip`, `std::views::join` and friends. The standard adaptors
+// advance every input with its own iterator, which resumes its coroutine
+// once per element and checks for its end once per element. The
+// combinators here instead nest coroutines with `elements_of` (so the hops
+// between them are symmetric transfers) or pull from their inputs a batch at
+// a time and only check for the end of an input at batch boundaries.
+
+namespace custom {
+
+/// The elements of `first`, then those of every generator in `rest`. The
+/// generators are nested with `elements_of`, so the consumer resumes the
+/// current one directly and switching to the next one is a symmetric
+/// transfer, there is no per-element forwarding through this coroutine.
+template<typename Ref, typename Val, typename Alloc, typename... Rest>
+requires (std::same_as<Rest, generator<Ref, Val, Alloc>> && ...)
+generator<Ref, Val>
+concat(generator<Ref, Val, Alloc> first, Rest... rest) {
+  co_yield std::ranges::elements_of(std::move(first));
+  ((co_yield std::ranges::elements_of(std::move(rest))), ...);
+}
+
+/// Pairs of the elements of `first` and `second`, until one of them is
+/// exhausted. The inputs are read with `next_batch` in chunks of
+/// `chunk_size`, i.e. with one resumption per chunk instead of one per
+/// element, so up to `chunk_size` elements are read ahead.
+template<typename G1, typename G2,
+        typename T1 = typename G1::batch_value_type, typename T2 = typename G2::batch_value_type>
+generator<std::pair<T1, T2>>
+zip(G1 first, G2 second, size_t chunk_size = 256) {
+  chunk_size = std::max(chunk_size, size_t{1});
+  std::vector<T1> firsts(chunk_size);
+  std::vector<T2> seconds(chunk_size);
+  while (true) {
+    size_t n = first.next_batch(firsts);
+    n = second.next_batch(std::span<T2>{seconds.data(), n});
+    if (n == 0) {
+      co_return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      co_yield std::pair<T1, T2>{std::move(firsts[i]), std::move(seconds[i])};
+    }
+  }
+}
+
+} // namespace custom
+
+namespace batched {
+
+/// The elements of a `batched::generator`, the same as `| std::views::join`,
+/// but the iterator only walks a pointer through the current batch and asks
+/// the generator for the next batch when it reaches the end, without the
+/// state machine of the generic join iterator.
+template<typename T, size_t BatchBytes>
+class join_view : public std::ranges::view_interface<join_view<T, BatchBytes>> {
+  using Gen = generator<T, BatchBytes>;
+
+  struct Iterator;
+
+public:
+  explicit join_view(Gen gen) noexcept: M_gen{std::move(gen)} {}
+
+  Iterator begin();
+
+  std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+private:
+  Gen M_gen;
+  std::optional<std::ranges::iterator_t<Gen>> M_it;
+};
+
+template<typename T, size_t BatchBytes>
+struct join_view<T, BatchBytes>::Iterator {
+  using value_type = T;
+  using difference_type = ptrdiff_t;
+
+  Iterator() = default;
+
+  explicit Iterator(join_view *view) : M_view{view} { M_enter(); }
+
+  friend bool
+  operator==(const Iterator &i, std::default_sentinel_t) noexcept { return i.M_cur == i.M_end; }
+
+  Iterator &
+  operator++() {
+    if (++M_cur == M_end) [[unlikely]] {
+      ++*M_view->M_it;
+      M_enter();
+    }
+    return *this;
+  }
+
+  void
+  operator++(int) { this->operator++(); }
+
+  T &operator*() const noexcept { return *M_cur; }
+
+private:
+  // Point to the current batch, skip empty ones.
+  void M_enter() {
+    auto &it = *M_view->M_it;
+    for (; it != std::default_sentinel; ++it) {
+      auto &b = *it;
+      if (!b.empty()) {
+        M_cur = b.begin();
+        M_end = b.end();
+        return;
+      }
+    }
+    M_cur = M_end = nullptr;
+  }
+
+  join_view *M_view = nullptr;
+  T *M_cur = nullptr;
+  T *M_end = nullptr;
+};
+
+template<typename T, size_t BatchBytes>
+auto join_view<T, BatchBytes>::begin() -> Iterator {
+  M_it.emplace(M_gen.begin());
+  return Iterator{this};
+}
+
+template<typename T, size_t BatchBytes>
+join_view<T, BatchBytes>
+join(generator<T, BatchBytes> gen) { return join_view<T, BatchBytes>{std::move(gen)}; }
+
+namespace detail {
+// The position in the current batch of a generator that is consumed by one
+// of the combinators. `M_cur == M_end` only at the end of the generator.
+template<typename T, size_t BatchBytes>
+struct batch_cursor {
+  std::ranges::iterator_t<generator<T, BatchBytes>> M_it;
+  T *M_cur = nullptr;
+  T *M_end = nullptr;
+
+  explicit batch_cursor(generator<T, BatchBytes> &gen) : M_it{gen.begin()} { M_enter(); }
+
+  bool M_done() const noexcept { return M_cur == M_end; }
+
+  size_t M_remaining() const noexcept { return static_cast<size_t>(M_end - M_cur); }
+
+  // Move on to the next batch once the current one is consumed.
+  void M_advance_if_empty() {
+    if (M_cur == M_end) {
+      ++M_it;
+      M_enter();
+    }
+  }
+
+  void M_enter() {
+    for (; M_it != std::default_sentinel; ++M_it) {
+      auto &b = *M_it;
+      if (!b.empty()) {
+        M_cur = b.begin();
+        M_end = b.end();
+        return;
+      }
+    }
+    M_cur = M_end = nullptr;
+  }
+
+  // Move up to `n` elements of the current batch to `sink`.
+  void M_move_to(batch_sink<T> &sink, size_t n) {
+    n = std::min(n, M_remaining());
+    for (size_t i = 0; i < n; ++i) {
+      sink.emplace_back(std::move(M_cur[i]));
+    }
+    M_cur += n;
+  }
+};
+} // namespace detail
+
+/// The elements of `first`, then those of every generator in `rest`. The
+/// batches of the inputs are moved to the output in bulk.
+template<typename T, size_t BatchBytes, typename... Rest>
+requires (std::same_as<Rest, generator<T, BatchBytes>> && ...)
+generator<T, BatchBytes>
+concat(generator<T, BatchBytes> first, Rest... rest) {
+  auto sink = co_await get_batch_sink;
+  for (auto *gen: {&first, &rest...}) {
+    for (detail::batch_cursor<T, BatchBytes> c{*gen}; !c.M_done(); c.M_advance_if_empty()) {
+      c.M_move_to(sink, sink.room());
+      co_await sink.flush();
+    }
+  }
+}
+
+/// Pairs of the elements of `first` and `second`, until one of them is
+/// exhausted. Runs of elements are paired up to the end of the shorter of
+/// the two current batches or of the output batch, without any check for
+/// the end of the inputs and without a suspension point per element.
+template<typename T1, size_t B1, typename T2, size_t B2>
+generator<std::pair<T1, T2>>
+zip(generator<T1, B1> first, generator<T2, B2> second) {
+  auto sink = co_await get_batch_sink;
+  detail::batch_cursor<T1, B1> c1{first};
+  detail::batch_cursor<T2, B2> c2{second};
+  while (!c1.M_done() && !c2.M_done()) {
+    const size_t n = std::min({c1.M_remaining(), c2.M_remaining(), sink.room()});
+    for (size_t i = 0; i < n; ++i) {
+      sink.emplace_back(std::move(c1.M_cur[i]), std::move(c2.M_cur[i]));
+    }
+    c1.M_cur += n;
+    c2.M_cur += n;
+    co_await sink.flush();
+    c1.M_advance_if_empty();
+    c2.M_advance_if_empty();
+  }
+}
+
+/// Merge two generators that are sorted by `comp` into one sorted
+/// generator. Equal elements of `first` come before those of `second`. If
+/// the rest of the current batch of one input is not greater than the next
+/// element of the other, it is moved to the output without comparisons.
+template<typename T, size_t BatchBytes, typename Comp = std::ranges::less>
+generator<T, BatchBytes>
+merge(generator<T, BatchBytes> first, generator<T, BatchBytes> second, Comp comp = {}) {
+  auto sink = co_await get_batch_sink;
+  detail::batch_cursor<T, BatchBytes> c1{first};
+  detail::batch_cursor<T, BatchBytes> c2{second};
+  while (!c1.M_done() && !c2.M_done()) {
+    if (!std::invoke(comp, *c2.M_cur, c1.M_end[-1])) {
+      c1.M_move_to(sink, sink.room());
+    } else if (std::invoke(comp, c2.M_end[-1], *c1.M_cur)) {
+      c2.M_move_to(sink, sink.room());
+    } else {
+      for (size_t n = sink.room(); n > 0 && c1.M_cur != c1.M_end && c2.M_cur != c2.M_end; --n) {
+        auto &c = std::invoke(comp, *c2.M_cur, *c1.M_cur) ? c2 : c1;
+        sink.emplace_back(std::move(*c.M_cur));
+        ++c.M_cur;
+      }
+    }
+    co_await sink.flush();
+    c1.M_advance_if_empty();
+    c2.M_advance_if_empty();
+  }
+  for (auto *c: {&c1, &c2}) {
+    for (; !c->M_done(); c->M_advance_if_empty()) {
+      c->M_move_to(sink, sink.room());
+      co_await sink.flush();
+    }
+  }
+}
+
+/// Merge any number of sorted generators with a balanced tree of two-way
+/// merges, every element passes through about `log2(inputs.size())` of
+/// them. Equal elements keep the order of the inputs.
+template<typename T, size_t BatchBytes, typename Comp = std::ranges::less>
+generator<T, BatchBytes>
+merge(std::vector<generator<T, BatchBytes>> inputs, Comp comp = {}) {
+  if (inputs.empty()) {
+    return []() -> generator<T, BatchBytes> { co_return; }();
+  }
+  while (inputs.size() > 1) {
+    std::vector<generator<T, BatchBytes>> next;
+    next.reserve((inputs.size() + 1) / 2);
+    for (size_t i = 0; i + 1 < inputs.size(); i += 2) {
+      next.push_back(merge(std::move(inputs[i]), std::move(inputs[i + 1]), comp));
+    }
+    if (inputs.size() % 2 != 0) {
+      next.push_back(std::move(inputs.back()));
+    }
+    inputs = std::move(next);
+  }
+  return std::move(inputs.front());
+}
+
+} // namespace batched
+
+#endif //STD_GENERATOR_EXAMPLES_GENERATOR_COMBINATORS_H
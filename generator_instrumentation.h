@@ -0,0 +1,103 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_GENERATOR_INSTRUMENTATION_H
+#define STD_GENERATOR_EXAMPLES_GENERATOR_INSTRUMENTATION_H
+
+// Opt-in counters for the coroutine frames, resumptions and yields of
+// `custom::generator` and `batched::generator`. Compile with
+// `-DGENERATOR_INSTRUMENTATION` to enable them, otherwise the hooks expand to
+// nothing and the generators are not changed at all. The counters are shared
+// atomics and cost several nanoseconds per yield, so take the timings from
+// an uninstrumented build.
+//
+// A frame allocation that the compiler has elided (HALO) never reaches the
+// promise's `operator new`, so it does not show up here. Comparing the counts
+// with the number of generators that were created tells whether the
+// allocation was elided without reading the assembly.
+
+#ifdef GENERATOR_INSTRUMENTATION
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+
+namespace generator_instrumentation {
+
+/// The counters of all threads, generators may run on worker threads.
+struct counters {
+  std::atomic<size_t> frame_allocs{0};
+  std::atomic<size_t> frame_deallocs{0};
+  std::atomic<size_t> frame_bytes{0};
+  std::atomic<size_t> resumes{0};
+  std::atomic<size_t> yields{0};
+
+  // The number of frames per frame size. All frames of the same coroutine
+  // have the same size, so this is approximately a histogram per coroutine.
+  std::mutex sizes_mutex;
+  std::map<size_t, size_t> sizes;
+};
+
+inline counters &global() noexcept {
+  static counters c;
+  return c;
+}
+
+/// A copy of the counters at one point in time, see `take_snapshot`.
+struct snapshot {
+  size_t frame_allocs = 0;
+  size_t frame_deallocs = 0;
+  size_t frame_bytes = 0;
+  size_t resumes = 0;
+  size_t yields = 0;
+  std::map<size_t, size_t> sizes;
+};
+
+inline snapshot take_snapshot() {
+  auto &c = global();
+  snapshot s{c.frame_allocs.load(), c.frame_deallocs.load(), c.frame_bytes.load(), c.resumes.load(),
+             c.yields.load(), {}};
+  std::lock_guard lock{c.sizes_mutex};
+  s.sizes = c.sizes;
+  return s;
+}
+
+inline void record_frame_alloc(size_t bytes) {
+  auto &c = global();
+  c.frame_allocs.fetch_add(1, std::memory_order_relaxed);
+  c.frame_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  std::lock_guard lock{c.sizes_mutex};
+  ++c.sizes[bytes];
+}
+
+inline void record_frame_dealloc() noexcept {
+  global().frame_deallocs.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void record_resume() noexcept {
+  global().resumes.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void record_yield() noexcept {
+  global().yields.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace generator_instrumentation
+
+#define GENERATOR_RECORD_FRAME_ALLOC(bytes) ::generator_instrumentation::record_frame_alloc(bytes)
+#define GENERATOR_RECORD_FRAME_DEALLOC() ::generator_instrumentation::record_frame_dealloc()
+#define GENERATOR_RECORD_RESUME() ::generator_instrumentation::record_resume()
+#define GENERATOR_RECORD_YIELD() ::generator_instrumentation::record_yield()
+
+#else
+
+#define GENERATOR_RECORD_FRAME_ALLOC(bytes) ((void) 0)
+#define GENERATOR_RECORD_FRAME_DEALLOC() ((void) 0)
+#define GENERATOR_RECORD_RESUME() ((void) 0)
+#define GENERATOR_RECORD_YIELD() ((void) 0)
+
+#endif
+
+#endif //STD_GENERATOR_EXAMPLES_GENERATOR_INSTRUMENTATION_H
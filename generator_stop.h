@@ -0,0 +1,57 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_GENERATOR_STOP_H
+#define STD_GENERATOR_EXAMPLES_GENERATOR_STOP_H
+
+#include <atomic>
+#include <coroutine>
+
+// Cooperative cancellation of a generator, shared by `custom::generator`
+// and `batched::generator`. The consumer calls `request_stop()` on the
+// generator, the coroutine body obtains a token once and checks it in its
+// loop:
+//
+//   auto stop = co_await custom::get_stop_token;
+//   while (!stop.stop_requested())
+//     co_yield next();
+//
+// Unlike `std::stop_token`, the token needs no shared state on the heap,
+// it points to a flag in the generator's (bottom) frame.
+namespace generator_stop {
+
+/// Whether a stop was requested for the generator. Checking it is a single
+/// relaxed load. Only valid while the coroutine that obtained it is alive.
+class stop_token {
+public:
+  explicit stop_token(const std::atomic<bool> &flag) noexcept: M_flag{&flag} {}
+
+  bool
+  stop_requested() const noexcept { return M_flag->load(std::memory_order_relaxed); }
+
+private:
+  const std::atomic<bool> *M_flag;
+};
+
+struct get_stop_token_t {
+  explicit get_stop_token_t() = default;
+};
+
+/// `co_await get_stop_token` in a generator yields its `stop_token`.
+inline constexpr get_stop_token_t get_stop_token{};
+
+/// Never suspends, only hands out the token.
+struct stop_token_awaiter {
+  stop_token M_token;
+
+  constexpr bool await_ready() const noexcept { return true; }
+
+  constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+  stop_token await_resume() const noexcept { return M_token; }
+};
+
+} // namespace generator_stop
+
+#endif //STD_GENERATOR_EXAMPLES_GENERATOR_STOP_H
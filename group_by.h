@@ -0,0 +1,256 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_GROUP_BY_H
+#define STD_GENERATOR_EXAMPLES_GROUP_BY_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./thread_pool.h"
+
+namespace batched {
+
+/// The sum, count, minimum and maximum of the values of one group.
+template<typename V>
+struct group_aggregate {
+  static_assert(std::is_arithmetic_v<V>);
+
+  V sum{};
+  size_t count = 0;
+  V min = std::numeric_limits<V>::max();
+  V max = std::numeric_limits<V>::lowest();
+
+  void add(V value) noexcept {
+    sum += value;
+    ++count;
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+
+  void merge(const group_aggregate &other) noexcept {
+    sum += other.sum;
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+  }
+};
+
+struct group_by_options {
+  /// The threads of the partitioned aggregation, `ThreadPool::global()` if
+  /// not set. With a single thread there is only one hash table.
+  ThreadPool *pool = nullptr;
+  /// The number of elements that are partitioned before the partitions are
+  /// aggregated in parallel.
+  size_t round_size = size_t{1} << 16;
+};
+
+namespace detail {
+/// The number of elements whose hashes are computed and whose slots are
+/// prefetched before the first of them is inserted.
+constexpr static size_t GROUP_BY_CHUNK = 32;
+
+// A key with its value and its hash, which is computed once per element.
+template<typename K, typename V>
+struct group_entry {
+  K M_key;
+  V M_value;
+  uint64_t M_hash;
+};
+
+// `std::hash` of integers is the identity, spread the bits so that the top
+// bits, which select the slot and the partition, depend on all of them.
+inline uint64_t mix_hash(uint64_t h) noexcept { return h * 0x9E3779B97F4A7C15ull; }
+} // namespace detail
+
+/// An open-addressing hash table from keys to their `group_aggregate`, with
+/// linear probing and at most three quarters of the slots in use. A slot
+/// stores the key and the aggregate together, so an update touches a single
+/// cache line in the common case. Elements are added in chunks: the slots of a chunk
+/// are prefetched first, so the cache misses of the chunk overlap.
+template<typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class aggregate_table {
+  // A slot is empty while the count of its aggregate is zero.
+  struct Slot {
+    K M_key{};
+    group_aggregate<V> M_agg;
+  };
+
+public:
+  using entry = detail::group_entry<K, V>;
+
+  /// `skip_bits` top bits of the hashes are the same for all keys of this
+  /// table, because they select its partition.
+  explicit aggregate_table(unsigned skip_bits = 0) : M_skip{skip_bits} { M_resize(16); }
+
+  size_t size() const noexcept { return M_size; }
+
+  uint64_t hash(const K &key) const { return detail::mix_hash(static_cast<uint64_t>(M_hasher(key))); }
+
+  /// Add `n` entries, whose hashes must have been computed with `hash`.
+  void add(const entry *entries, size_t n) {
+    for (size_t begin = 0; begin < n; begin += detail::GROUP_BY_CHUNK) {
+      const size_t end = std::min(begin + detail::GROUP_BY_CHUNK, n);
+      // Every entry of the chunk may be a new key.
+      size_t capacity = M_slots.size();
+      while ((M_size + (end - begin)) * 4 > capacity * 3) {
+        capacity *= 2;
+      }
+      if (capacity != M_slots.size()) {
+        M_resize(capacity);
+      }
+      size_t index[detail::GROUP_BY_CHUNK];
+      Slot *slots = M_slots.data();
+      for (size_t i = begin; i < end; ++i) {
+        index[i - begin] = M_index(entries[i].M_hash);
+        __builtin_prefetch(slots + index[i - begin], 1);
+      }
+      for (size_t i = begin; i < end; ++i) {
+        M_find_or_insert(entries[i].M_key, index[i - begin]).add(entries[i].M_value);
+      }
+    }
+  }
+
+  /// Call `f(key, aggregate)` for every group.
+  template<typename F>
+  void for_each(F f) const {
+    for (const auto &slot: M_slots) {
+      if (slot.M_agg.count != 0) {
+        f(slot.M_key, slot.M_agg);
+      }
+    }
+  }
+
+private:
+  size_t M_index(uint64_t hash) const noexcept { return static_cast<size_t>((hash << M_skip) >> M_shift); }
+
+  // The aggregate of `key`, which belongs to slot `i` if there are no
+  // collisions.
+  group_aggregate<V> &M_find_or_insert(const K &key, size_t i) {
+    const size_t mask = M_slots.size() - 1;
+    for (;; i = (i + 1) & mask) {
+      auto &slot = M_slots[i];
+      if (slot.M_agg.count == 0) {
+        slot.M_key = key;
+        ++M_size;
+        return slot.M_agg;
+      }
+      if (M_eq(slot.M_key, key)) {
+        return slot.M_agg;
+      }
+    }
+  }
+
+  void M_resize(size_t capacity) {
+    auto old = std::exchange(M_slots, std::vector<Slot>(capacity));
+    M_shift = 64 - static_cast<unsigned>(std::countr_zero(capacity));
+    M_size = 0;
+    for (auto &slot: old) {
+      if (slot.M_agg.count != 0) {
+        M_find_or_insert(slot.M_key, M_index(hash(slot.M_key))).merge(slot.M_agg);
+      }
+    }
+  }
+
+  std::vector<Slot> M_slots;
+  size_t M_size = 0;
+  unsigned M_skip;
+  unsigned M_shift = 64;
+  [[no_unique_address]] Hash M_hasher;
+  [[no_unique_address]] Eq M_eq;
+};
+
+/// Group the elements of `source`, a range of batches such as a
+/// `batched::generator<T>`, by `key(element)` and aggregate
+/// `value(element)` per group, see `group_aggregate`. Returns the groups in
+/// no particular order.
+///
+/// With more than one thread in the pool, the elements are partitioned by
+/// the top bits of the hash of their key. Every `round_size` elements, the
+/// partitions are aggregated into one hash table per partition in parallel,
+/// while the consumer of the source waits. The key sets of the partitions
+/// are disjoint, so merging the tables at the end is a concatenation.
+template<std::ranges::input_range R, typename KeyFn, typename ValueFn,
+        typename Hash = std::hash<std::remove_cvref_t<std::invoke_result_t<
+                KeyFn &, std::ranges::range_reference_t<std::ranges::range_reference_t<R>>>>>>
+auto
+group_by_aggregate(R &&source, KeyFn key, ValueFn value, group_by_options options = {}) {
+  using Element = std::ranges::range_reference_t<std::ranges::range_reference_t<R>>;
+  using K = std::remove_cvref_t<std::invoke_result_t<KeyFn &, Element>>;
+  using V = std::remove_cvref_t<std::invoke_result_t<ValueFn &, Element>>;
+  using Table = aggregate_table<K, V, Hash>;
+  using Entry = typename Table::entry;
+
+  auto &pool = options.pool ? *options.pool : ThreadPool::global();
+  const size_t num_partitions = pool.size() == 1 ? 1 : std::bit_ceil(pool.size() * 4);
+  const auto partition_bits = static_cast<unsigned>(std::countr_zero(num_partitions));
+  std::vector<Table> tables;
+  for (size_t p = 0; p < num_partitions; ++p) {
+    tables.emplace_back(partition_bits);
+  }
+
+  std::vector<std::vector<Entry>> partitions(num_partitions);
+  size_t num_pending = 0;
+  auto aggregate_partitions = [&] {
+    pool.parallelFor(num_partitions, 1, [&](size_t begin, size_t end) {
+      for (size_t p = begin; p < end; ++p) {
+        tables[p].add(partitions[p].data(), partitions[p].size());
+        partitions[p].clear();
+      }
+    });
+    num_pending = 0;
+  };
+
+  Entry chunk[detail::GROUP_BY_CHUNK];
+  for (auto &&batch: source) {
+    auto it = std::ranges::begin(batch);
+    const auto end = std::ranges::end(batch);
+    while (it != end) {
+      size_t n = 0;
+      for (; n < detail::GROUP_BY_CHUNK && it != end; ++n, ++it) {
+        auto &&el = *it;
+        chunk[n].M_key = std::invoke(key, el);
+        chunk[n].M_value = std::invoke(value, el);
+        chunk[n].M_hash = tables.front().hash(chunk[n].M_key);
+      }
+      if (num_partitions == 1) {
+        tables.front().add(chunk, n);
+        continue;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        partitions[chunk[i].M_hash >> (64 - partition_bits)].push_back(chunk[i]);
+      }
+      num_pending += n;
+      if (num_pending >= options.round_size) {
+        aggregate_partitions();
+      }
+    }
+  }
+  if (num_pending != 0) {
+    aggregate_partitions();
+  }
+
+  std::vector<std::pair<K, group_aggregate<V>>> result;
+  size_t total = 0;
+  for (const auto &table: tables) {
+    total += table.size();
+  }
+  result.reserve(total);
+  for (const auto &table: tables) {
+    table.for_each([&](const K &k, const group_aggregate<V> &agg) { result.emplace_back(k, agg); });
+  }
+  return result;
+}
+
+} // namespace batched
+
+#endif //STD_GENERATOR_EXAMPLES_GROUP_BY_H
@@ -0,0 +1,252 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include "./benchmark_counters.h"
+#include "./IndirectIota.h"
+#include "./expression_sources.h"
+#include "./external_sort.h"
+#include "./file_sources.h"
+#include "./streaming_expression.h"
+
+// The input files, written once to the temp directory and removed at exit.
+// All benchmarks read them from the page cache, so they compare the cost of
+// getting the bytes into the program, not the speed of the disk.
+struct InputFiles {
+    static constexpr size_t NUM_VALUES = 4 << 20;
+    static constexpr size_t NUM_LINES = 2 << 20;
+
+    std::string column;
+    std::string lines;
+
+    InputFiles() {
+        auto dir = std::filesystem::temp_directory_path();
+        auto prefix = "generator_io_benchmark_" + std::to_string(::getpid());
+        column = dir / (prefix + ".bin");
+        lines = dir / (prefix + ".txt");
+
+        std::vector<double> values(NUM_VALUES);
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<double>(i % 1000) * 0.5;
+        }
+        std::ofstream{column, std::ios::binary}.write(reinterpret_cast<const char*>(values.data()),
+                                                      static_cast<std::streamsize>(values.size() * sizeof(double)));
+        std::ofstream text{lines};
+        for (size_t i = 0; i < NUM_LINES; ++i) {
+            text << i * 7919 << ",some text\n";
+        }
+    }
+
+    ~InputFiles() {
+        std::filesystem::remove(column);
+        std::filesystem::remove(lines);
+    }
+};
+
+static const InputFiles& inputFiles() {
+    static InputFiles files;
+    return files;
+}
+
+// The same summation for all column benchmarks, with independent
+// accumulators so that it is not bound by the latency of the additions.
+static double sumValues(std::span<const double> values) {
+    double s[4] = {};
+    size_t i = 0;
+    for (; i + 4 <= values.size(); i += 4) {
+        for (size_t k = 0; k < 4; ++k) {
+            s[k] += values[i + k];
+        }
+    }
+    for (; i < values.size(); ++i) {
+        s[0] += values[i];
+    }
+    return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+static void BM_ColumnIfstream(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    std::vector<double> buffer(MAPPED_CHUNK_BYTES / sizeof(double));
+    for (auto _ : state) {
+        std::ifstream in{files.column, std::ios::binary};
+        double sum = 0;
+        while (in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(double))) ||
+               in.gcount() > 0) {
+            sum += sumValues({buffer.data(), static_cast<size_t>(in.gcount()) / sizeof(double)});
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * InputFiles::NUM_VALUES * sizeof(double));
+}
+
+static void BM_ColumnMapped(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    for (auto _ : state) {
+        double sum = 0;
+        for (auto chunk : mapped_column_gen<double>(files.column)) {
+            sum += sumValues(chunk);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * InputFiles::NUM_VALUES * sizeof(double));
+}
+
+// The column as a leaf of an expression, `sum(column * 2)`, copied into
+// `Arg`s and without a copy as a stream.
+static void BM_ColumnMappedExp(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& arg : binaryExpression(mappedColumnExp(MappedFile{files.column}, streaming::CHUNK_SIZE),
+                                                constantExp(2.0), std::multiplies{})) {
+            sum += sumValues(std::get<std::vector<double>>(arg));
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * InputFiles::NUM_VALUES * sizeof(double));
+}
+
+static void BM_ColumnMappedStreaming(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(streaming::sum(streaming::binaryExpression(
+                streaming::mappedColumn(MappedFile{files.column}), streaming::scalar(2.0), std::multiplies{})));
+    }
+    state.SetBytesProcessed(state.iterations() * InputFiles::NUM_VALUES * sizeof(double));
+}
+
+// One chunk after the other with a blocking `pread` into the same buffer,
+// the baseline for the asynchronous reads.
+static void BM_ColumnSyncRead(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    std::vector<double> buffer(AsyncReadOptions{}.chunkBytes / sizeof(double));
+    for (auto _ : state) {
+        const int fd = ::open(files.column.c_str(), O_RDONLY | O_CLOEXEC);
+        double sum = 0;
+        off_t offset = 0;
+        ssize_t n;
+        while ((n = ::pread(fd, buffer.data(), buffer.size() * sizeof(double), offset)) > 0) {
+            sum += sumValues({buffer.data(), static_cast<size_t>(n) / sizeof(double)});
+            offset += n;
+        }
+        ::close(fd);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * InputFiles::NUM_VALUES * sizeof(double));
+}
+
+// The same with `range(0)` chunks read ahead, with `O_DIRECT` if `range(1)`.
+// The reads happen on other threads, so the wall time is measured.
+static void BM_ColumnAsync(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    const AsyncReadOptions options{.inFlight = static_cast<size_t>(state.range(0)),
+                                   .direct = state.range(1) != 0};
+    for (auto _ : state) {
+        double sum = 0;
+        for (auto chunk : async_column_gen<double>(files.column, options)) {
+            sum += sumValues(chunk);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * InputFiles::NUM_VALUES * sizeof(double));
+    state.SetLabel(AsyncFileReader{files.column, options}.usesIoUring() ? "io_uring" : "threads");
+}
+
+static void BM_LinesGetline(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    size_t numLines = 0;
+    for (auto _ : state) {
+        std::ifstream in{files.lines};
+        std::string line;
+        size_t bytes = 0;
+        while (std::getline(in, line)) {
+            bytes += line.size();
+            ++numLines;
+        }
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(numLines);
+}
+
+static void BM_LinesMapped(benchmark::State& state){
+    CounterScope counters{state};
+    const auto& files = inputFiles();
+    size_t numLines = 0;
+    for (auto _ : state) {
+        size_t bytes = 0;
+        for (const auto& batch : mapped_lines_gen(files.lines)) {
+            for (std::string_view line : batch) {
+                bytes += line.size();
+            }
+            numLines += batch.size();
+        }
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(numLines);
+}
+
+// Sort a permutation of `[0, SORT_SIZE)`, produced by `iota_gen_batched`,
+// with `state.range(0)` MiB of memory on `state.range(1)` threads. With the
+// largest budget and up to two threads the input fits into a single run and
+// is sorted without any files.
+static constexpr size_t SORT_SIZE = 1 << 22;
+
+// A multiplication with an odd number is a bijection modulo a power of two.
+auto permute = [](size_t i) { return (i * 0x9E3779B97F4A7C15) & (SORT_SIZE - 1); };
+
+static void BM_ExternalSort(benchmark::State& state){
+    CounterScope counters{state};
+    ThreadPool pool{static_cast<size_t>(state.range(1))};
+    const batched::external_sort_options options{.memory_budget = static_cast<size_t>(state.range(0)) << 20,
+                                                 .pool = &pool};
+    for (auto _ : state) {
+        size_t res = 0;
+        for (auto& batch : batched::external_sort<size_t>(iota_gen_batched_n(SORT_SIZE, permute), options)) {
+            res += batch.back();
+        }
+        benchmark::DoNotOptimize(res);
+    }
+    state.SetItemsProcessed(state.iterations() * SORT_SIZE);
+}
+
+// Collect everything and `std::sort` it, the baseline without a memory
+// limit.
+static void BM_SortInMemory(benchmark::State& state){
+    CounterScope counters{state};
+    for (auto _ : state) {
+        std::vector<size_t> values;
+        values.reserve(SORT_SIZE);
+        for (auto& batch : iota_gen_batched_n(SORT_SIZE, permute)) {
+            values.insert(values.end(), batch.begin(), batch.end());
+        }
+        std::sort(values.begin(), values.end());
+        benchmark::DoNotOptimize(values.back());
+    }
+    state.SetItemsProcessed(state.iterations() * SORT_SIZE);
+}
+
+BENCHMARK(BM_ColumnIfstream);
+BENCHMARK(BM_ColumnMapped);
+BENCHMARK(BM_ColumnMappedExp);
+BENCHMARK(BM_ColumnMappedStreaming);
+BENCHMARK(BM_ColumnSyncRead);
+BENCHMARK(BM_ColumnAsync)->ArgNames({"in_flight", "direct"})->ArgsProduct({{1, 2, 4, 8, 16}, {0, 1}})->UseRealTime();
+BENCHMARK(BM_LinesGetline);
+BENCHMARK(BM_LinesMapped);
+BENCHMARK(BM_SortInMemory)->UseRealTime();
+BENCHMARK(BM_ExternalSort)->ArgNames({"budget_mib", "threads"})->ArgsProduct({{4, 16, 128}, {1, 2, 4, 8}})->UseRealTime();
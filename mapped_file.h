@@ -0,0 +1,110 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_MAPPED_FILE_H
+#define STD_GENERATOR_EXAMPLES_MAPPED_FILE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A read-only memory mapping of a whole file. The pages are read on demand
+// by the kernel, so a multi-GB file costs no memory up front and nothing is
+// copied into user space buffers.
+class MappedFile {
+public:
+    // Map the file at `path`, throws `std::system_error` if it can not be
+    // opened or mapped.
+    explicit MappedFile(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error{errno, std::generic_category(), "Could not open " + path};
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error{err, std::generic_category(), "Could not stat " + path};
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        // An empty mapping is not allowed, an empty file has no data.
+        if (size_ != 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                const int err = errno;
+                ::close(fd);
+                throw std::system_error{err, std::generic_category(), "Could not map " + path};
+            }
+            data_ = static_cast<const std::byte*>(data);
+        }
+        // The mapping stays valid after the descriptor is closed.
+        ::close(fd);
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)} {}
+
+    MappedFile& operator=(MappedFile other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(const_cast<std::byte*>(data_), size_);
+        }
+    }
+
+    const std::byte* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // The file as an array of `T`. Throws `std::invalid_argument` if the size
+    // is not a multiple of `sizeof(T)`.
+    template <typename T>
+    std::span<const T> as() const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (size_ % sizeof(T) != 0) {
+            throw std::invalid_argument{"The size of the file " + std::to_string(size_) +
+                                        " is not a multiple of the element size " + std::to_string(sizeof(T))};
+        }
+        return {reinterpret_cast<const T*>(data_), size_ / sizeof(T)};
+    }
+
+    // Tell the kernel that the file is read front to back, it then reads
+    // ahead more aggressively and drops the pages behind the reader earlier.
+    void adviseSequential() const { advise(0, size_, MADV_SEQUENTIAL); }
+
+    // Start reading `[offset, offset + length)` in the background.
+    void adviseWillNeed(size_t offset, size_t length) const { advise(offset, length, MADV_WILLNEED); }
+
+private:
+    // The advice is only a hint, errors are ignored.
+    void advise(size_t offset, size_t length, int advice) const {
+        if (!data_ || offset >= size_) {
+            return;
+        }
+        // `madvise` needs a page-aligned address.
+        static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        const size_t aligned = offset / pageSize * pageSize;
+        length = std::min(length + (offset - aligned), size_ - aligned);
+        ::madvise(const_cast<std::byte*>(data_) + aligned, length, advice);
+    }
+
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif //STD_GENERATOR_EXAMPLES_MAPPED_FILE_H
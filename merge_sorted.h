@@ -0,0 +1,197 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_MERGE_SORTED_H
+#define STD_GENERATOR_EXAMPLES_MERGE_SORTED_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ranges>
+#include <span>
+#include <vector>
+
+#include "./batched_generator.h"
+#include "./generator_combinators.h"
+#include "./simple_generator.h"
+
+namespace batched {
+
+namespace detail {
+// The position in a chunk of a `custom::generator` that is read with
+// `next_batch`, with the same interface as `batch_cursor`.
+template<typename G>
+struct chunk_cursor {
+  using T = typename G::batch_value_type;
+
+  G *M_gen;
+  std::vector<T> M_chunk;
+  T *M_cur = nullptr;
+  T *M_end = nullptr;
+
+  chunk_cursor(G &gen, size_t chunk_size) : M_gen{&gen}, M_chunk(std::max(chunk_size, size_t{1})) { M_enter(); }
+
+  bool M_done() const noexcept { return M_cur == M_end; }
+
+  void M_advance_if_empty() {
+    if (M_cur == M_end) {
+      M_enter();
+    }
+  }
+
+  void M_enter() {
+    const size_t n = M_gen->next_batch(M_chunk);
+    M_cur = M_chunk.data();
+    M_end = M_cur + n;
+  }
+};
+
+// A tournament tree over the fronts of `k` sorted inputs, the inner nodes
+// store the loser of the comparison at that node and `M_tree[0]` the
+// overall winner. Replacing the winner with the next element of its input
+// costs one comparison per level on the path to the root, `log2(k)` in
+// total, and unlike a binary heap no comparison between the two children of
+// a node. The tree and the pointers to the fronts are two small contiguous
+// arrays, the inputs themselves are only touched to advance the winner.
+template<typename T, typename Comp>
+class loser_tree {
+public:
+  loser_tree(size_t k, Comp comp)
+          : M_leaves{std::bit_ceil(std::max(k, size_t{1}))}, M_tree(M_leaves), M_heads(M_leaves, nullptr),
+            M_comp{std::move(comp)} {}
+
+  /// Set the front of input `i`, `nullptr` once it is exhausted. Call
+  /// `M_build` after the fronts of all inputs have been set.
+  void M_set_head(size_t i, T *head) noexcept { M_heads[i] = head; }
+
+  void M_build() {
+    std::vector<uint32_t> winners(2 * M_leaves);
+    for (size_t i = 0; i < M_leaves; ++i) {
+      winners[M_leaves + i] = static_cast<uint32_t>(i);
+    }
+    for (size_t n = M_leaves - 1; n > 0; --n) {
+      auto a = winners[2 * n];
+      auto b = winners[2 * n + 1];
+      if (M_beats(b, a)) {
+        std::swap(a, b);
+      }
+      winners[n] = a;
+      M_tree[n] = b;
+    }
+    M_tree[0] = winners[1];
+  }
+
+  /// Whether all inputs are exhausted.
+  bool M_empty() const noexcept { return M_heads[M_tree[0]] == nullptr; }
+
+  /// The input whose front is the smallest element.
+  size_t M_winner() const noexcept { return M_tree[0]; }
+
+  /// The front of the winning input has changed (or it is exhausted),
+  /// restore the tree.
+  void M_replace_top(T *head) {
+    auto w = M_tree[0];
+    M_heads[w] = head;
+    for (size_t n = (w + M_leaves) / 2; n > 0; n /= 2) {
+      if (M_beats(M_tree[n], w)) {
+        std::swap(M_tree[n], w);
+      }
+    }
+    M_tree[0] = w;
+  }
+
+private:
+  // Whether the front of input `a` comes before that of input `b`. Equal
+  // elements are taken from the input with the lower index first, so the
+  // merge is stable. Exhausted inputs lose against everything.
+  bool M_beats(uint32_t a, uint32_t b) const {
+    const T *ha = M_heads[a];
+    const T *hb = M_heads[b];
+    if (!ha || !hb) {
+      return ha != nullptr;
+    }
+    return a < b ? !std::invoke(M_comp, *hb, *ha) : std::invoke(M_comp, *ha, *hb);
+  }
+
+  size_t M_leaves;
+  std::vector<uint32_t> M_tree;
+  std::vector<T *> M_heads;
+  [[no_unique_address]] Comp M_comp;
+};
+
+// Merge the inputs behind the cursors that `make_cursors` returns. They are
+// only created once the consumer asks for the first batch.
+template<typename T, size_t BatchBytes, typename Make, typename Comp>
+generator<T, BatchBytes>
+merge_cursors(Make make_cursors, Comp comp) {
+  auto sink = co_await get_batch_sink;
+  auto cursors = make_cursors();
+  loser_tree<T, Comp> tree{cursors.size(), std::move(comp)};
+  for (size_t i = 0; i < cursors.size(); ++i) {
+    tree.M_set_head(i, cursors[i].M_done() ? nullptr : cursors[i].M_cur);
+  }
+  tree.M_build();
+  while (!tree.M_empty()) {
+    for (size_t n = sink.room(); n > 0 && !tree.M_empty(); --n) {
+      auto &c = cursors[tree.M_winner()];
+      sink.emplace_back(std::move(*c.M_cur));
+      if (++c.M_cur == c.M_end) [[unlikely]] {
+        c.M_advance_if_empty();
+      }
+      tree.M_replace_top(c.M_done() ? nullptr : c.M_cur);
+    }
+    co_await sink.flush();
+  }
+}
+} // namespace detail
+
+/// The number of bytes that the current batches of all inputs of
+/// `merge_sorted` may occupy together, with a high fan-in the batches of
+/// the inputs are made smaller so that they stay in the L2 cache.
+constexpr static size_t MERGE_INPUT_BYTES = 1 << 19;
+
+/// Merge any number of generators that are sorted by `comp` into one sorted
+/// generator with a loser tree. Every element costs about `log2(k)`
+/// comparisons for `k` inputs, and the inputs are read a batch at a time.
+/// Equal elements keep the order of the inputs. The generators in `inputs`
+/// must outlive the result.
+template<typename T, size_t BatchBytes, typename Comp = std::ranges::less>
+generator<T, BatchBytes>
+merge_sorted(std::span<generator<T, BatchBytes>> inputs, Comp comp = {}) {
+  auto make_cursors = [inputs] {
+    std::vector<detail::batch_cursor<T, BatchBytes>> cursors;
+    cursors.reserve(inputs.size());
+    const size_t max_batch_size = std::max(MERGE_INPUT_BYTES / sizeof(T) / std::max(inputs.size(), size_t{1}),
+                                           size_t{16});
+    for (auto &gen: inputs) {
+      gen.set_batch_size(std::min(gen.batch_size(), max_batch_size));
+      cursors.emplace_back(gen);
+    }
+    return cursors;
+  };
+  return detail::merge_cursors<T, BatchBytes>(make_cursors, std::move(comp));
+}
+
+/// The same for `custom::generator`s, which are read with `next_batch` in
+/// chunks of `chunk_size` elements.
+template<typename Ref, typename Val, typename Alloc, typename Comp = std::ranges::less,
+        typename T = typename custom::generator<Ref, Val, Alloc>::batch_value_type>
+generator<T>
+merge_sorted(std::span<custom::generator<Ref, Val, Alloc>> inputs, Comp comp = {}, size_t chunk_size = 256) {
+  auto make_cursors = [inputs, chunk_size] {
+    std::vector<detail::chunk_cursor<custom::generator<Ref, Val, Alloc>>> cursors;
+    cursors.reserve(inputs.size());
+    for (auto &gen: inputs) {
+      cursors.emplace_back(gen, chunk_size);
+    }
+    return cursors;
+  };
+  return detail::merge_cursors<T, BATCH_BYTES>(make_cursors, std::move(comp));
+}
+
+} // namespace batched
+
+#endif //STD_GENERATOR_EXAMPLES_MERGE_SORTED_H
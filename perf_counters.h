@@ -0,0 +1,129 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_PERF_COUNTERS_H
+#define STD_GENERATOR_EXAMPLES_PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define STD_GENERATOR_EXAMPLES_HAS_PERF_EVENTS 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters of the calling thread (and of the threads it
+// starts while counting) via `perf_event_open`. Only user space is counted,
+// which is allowed with the default `perf_event_paranoid` of 2. If an event
+// is not supported, e.g. in a VM or container without a PMU, or the system
+// call is not allowed, `read()` returns `std::nullopt` for it, so callers
+// simply report fewer numbers.
+class PerfCounters {
+public:
+    enum Event : size_t { Cycles, Instructions, BranchMisses, L1dMisses, NUM_EVENTS };
+
+    using Values = std::array<std::optional<double>, NUM_EVENTS>;
+
+    // Open the events and start counting.
+    PerfCounters() {
+#ifdef STD_GENERATOR_EXAMPLES_HAS_PERF_EVENTS
+        if (!supported()) {
+            return;
+        }
+        bool any = false;
+        for (size_t i = 0; i < NUM_EVENTS; ++i) {
+            fds_[i] = open(static_cast<Event>(i));
+            any = any || fds_[i] >= 0;
+        }
+        // Don't try again for every benchmark if nothing can be counted.
+        if (!any) {
+            supported() = false;
+        }
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#ifdef STD_GENERATOR_EXAMPLES_HAS_PERF_EVENTS
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    // The counts since the construction. If the kernel had to multiplex the
+    // counters, the counts are extrapolated to the whole time.
+    Values read() const {
+        Values values;
+#ifdef STD_GENERATOR_EXAMPLES_HAS_PERF_EVENTS
+        for (size_t i = 0; i < NUM_EVENTS; ++i) {
+            // The layout of `PERF_FORMAT_TOTAL_TIME_ENABLED | ..._RUNNING`.
+            struct {
+                uint64_t value, enabled, running;
+            } data{};
+            if (fds_[i] < 0 || ::read(fds_[i], &data, sizeof(data)) != sizeof(data) || data.running == 0) {
+                continue;
+            }
+            values[i] = static_cast<double>(data.value) * static_cast<double>(data.enabled) /
+                        static_cast<double>(data.running);
+        }
+#endif
+        return values;
+    }
+
+private:
+    std::array<int, NUM_EVENTS> fds_{-1, -1, -1, -1};
+
+#ifdef STD_GENERATOR_EXAMPLES_HAS_PERF_EVENTS
+    static bool& supported() {
+        static bool supported = true;
+        return supported;
+    }
+
+    static int open(Event event) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        switch (event) {
+            case Cycles:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case Instructions:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case BranchMisses:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            default:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+        }
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+    }
+#endif
+};
+
+#endif //STD_GENERATOR_EXAMPLES_PERF_COUNTERS_H
@@ -0,0 +1,359 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_PIPELINE_H
+#define STD_GENERATOR_EXAMPLES_PIPELINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./prefetch.h"
+
+namespace batched {
+
+namespace detail {
+/// Apply `f` to every element of a batch.
+template<typename F>
+struct map_op {
+  F M_f;
+
+  template<typename T>
+  using output = std::remove_cvref_t<std::invoke_result_t<const F &, T &>>;
+
+  template<typename T, typename U>
+  void operator()(std::vector<T> &in, std::vector<U> &out) const {
+    out.clear();
+    out.reserve(in.size());
+    for (auto &el : in) {
+      out.push_back(std::invoke(M_f, el));
+    }
+  }
+};
+
+/// Keep the elements of a batch for which `pred` is true.
+template<typename P>
+struct filter_op {
+  P M_pred;
+
+  template<typename T>
+  using output = T;
+
+  template<typename T>
+  void operator()(std::vector<T> &in, std::vector<T> &out) const {
+    out.clear();
+    for (auto &el : in) {
+      if (std::invoke(M_pred, std::as_const(el))) {
+        out.push_back(std::move(el));
+      }
+    }
+  }
+};
+} // namespace detail
+
+/// A stage of a pipeline that applies `Op` to the batches of the source
+/// range `V` on a pool of worker threads. The source is read on the
+/// consumer's thread, up to a few batches per worker ahead of the consumer.
+/// Each worker has its own queue of batches and steals from the others when
+/// it runs dry. With `ordered`, a reorder buffer hands out the results in
+/// the order of the source, otherwise in the order in which they finish.
+/// The result is a range of (non-empty) batches, so stages can be chained.
+template<std::ranges::view V, typename Op>
+class parallel_view : public std::ranges::view_interface<parallel_view<V, Op>> {
+  using T = typename detail::prefetch_value<V>::type;
+  using U = typename Op::template output<T>;
+
+  static constexpr size_t npos = size_t(-1);
+
+  struct Slot {
+    std::vector<T> M_input;
+    std::vector<U> M_output;
+    std::exception_ptr M_except;
+    bool M_ready = false;
+  };
+
+  struct alignas(64) Queue {
+    std::mutex M_mutex;
+    std::deque<size_t> M_slots;
+  };
+
+  struct State {
+    State(V source, Op op, size_t threads, bool ordered, size_t batch_size)
+            : M_source{std::move(source)}, M_op{std::move(op)}, M_ordered{ordered},
+              M_batch_size{std::max(batch_size, size_t{1})}, M_slots(threads * in_flight_per_thread),
+              M_queues(threads) {
+      for (size_t i = M_slots.size(); i-- > 0;) {
+        M_free.push_back(i);
+      }
+      for (size_t i = 0; i < threads; ++i) {
+        M_workers.emplace_back([this, i](std::stop_token stop) { M_work(stop, i); });
+      }
+    }
+
+    // Only used on the consumer's thread.
+    V M_source;
+    std::optional<std::ranges::iterator_t<V>> M_it;
+    Op M_op;
+    bool M_ordered;
+    size_t M_batch_size;
+    std::vector<Slot> M_slots;
+    std::vector<size_t> M_free;
+    // The slots that are in flight, in the order of the source.
+    std::deque<size_t> M_order;
+    size_t M_next_queue = 0;
+
+    std::vector<Queue> M_queues;
+    std::atomic<size_t> M_queued{0};
+    std::mutex M_sleep_mutex;
+    std::condition_variable_any M_wake;
+
+    std::mutex M_done_mutex;
+    std::condition_variable M_done_cv;
+    // The slots that are finished, in the order in which they finished.
+    std::deque<size_t> M_done;
+
+    // Declared last, so that the workers are stopped before anything else
+    // is destroyed.
+    std::vector<std::jthread> M_workers;
+
+    bool M_pop(size_t self, size_t &slot) {
+      const size_t n = M_queues.size();
+      for (size_t k = 0; k < n; ++k) {
+        auto &q = M_queues[(self + k) % n];
+        std::lock_guard lock{q.M_mutex};
+        if (!q.M_slots.empty()) {
+          // The own queue in order, the others are robbed from the back.
+          if (k == 0) {
+            slot = q.M_slots.front();
+            q.M_slots.pop_front();
+          } else {
+            slot = q.M_slots.back();
+            q.M_slots.pop_back();
+          }
+          M_queued.fetch_sub(1, std::memory_order_relaxed);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void M_work(std::stop_token stop, size_t self) {
+      while (!stop.stop_requested()) {
+        size_t idx;
+        if (!M_pop(self, idx)) {
+          std::unique_lock lock{M_sleep_mutex};
+          M_wake.wait(lock, stop, [this] { return M_queued.load(std::memory_order_relaxed) != 0; });
+          continue;
+        }
+        auto &slot = M_slots[idx];
+        try {
+          M_op(slot.M_input, slot.M_output);
+        } catch (...) {
+          slot.M_except = std::current_exception();
+        }
+        {
+          std::lock_guard lock{M_done_mutex};
+          slot.M_ready = true;
+          M_done.push_back(idx);
+        }
+        M_done_cv.notify_one();
+      }
+    }
+
+    void M_submit(size_t idx) {
+      auto &q = M_queues[M_next_queue++ % M_queues.size()];
+      {
+        std::lock_guard lock{q.M_mutex};
+        q.M_slots.push_back(idx);
+      }
+      {
+        std::lock_guard lock{M_sleep_mutex};
+        M_queued.fetch_add(1, std::memory_order_relaxed);
+      }
+      M_wake.notify_one();
+    }
+
+    // Read the next batch of the source into `in`, false at the end.
+    bool M_read(std::vector<T> &in) {
+      in.clear();
+      if (!M_it) {
+        M_it.emplace(std::ranges::begin(M_source));
+      }
+      auto &it = *M_it;
+      const auto end = std::ranges::end(M_source);
+      if constexpr (enable_batch_range<V>) {
+        for (; it != end && in.empty(); ++it) {
+          for (auto &&el : *it) {
+            in.push_back(std::move(el));
+          }
+        }
+      } else {
+        for (; it != end && in.size() < M_batch_size; ++it) {
+          in.push_back(std::move(*it));
+        }
+      }
+      return !in.empty();
+    }
+
+    // Submit batches until all slots are busy or the source is exhausted.
+    void M_fill() {
+      while (!M_free.empty()) {
+        const size_t idx = M_free.back();
+        if (!M_read(M_slots[idx].M_input)) {
+          return;
+        }
+        M_free.pop_back();
+        M_order.push_back(idx);
+        M_submit(idx);
+      }
+    }
+
+    // Wait for the next result, `npos` at the end.
+    size_t M_next() {
+      while (true) {
+        M_fill();
+        if (M_order.empty()) {
+          return npos;
+        }
+        size_t idx;
+        {
+          std::unique_lock lock{M_done_mutex};
+          if (M_ordered) {
+            idx = M_order.front();
+            M_done_cv.wait(lock, [&] { return M_slots[idx].M_ready; });
+            std::erase(M_done, idx);
+          } else {
+            M_done_cv.wait(lock, [&] { return !M_done.empty(); });
+            idx = M_done.front();
+            M_done.pop_front();
+          }
+          M_slots[idx].M_ready = false;
+        }
+        std::erase(M_order, idx);
+        auto &slot = M_slots[idx];
+        if (auto e = std::exchange(slot.M_except, nullptr)) {
+          M_free.push_back(idx);
+          std::rethrow_exception(e);
+        }
+        if (!slot.M_output.empty()) {
+          return idx;
+        }
+        M_free.push_back(idx);
+      }
+    }
+  };
+
+  struct Iterator;
+
+public:
+  /// The number of batches per worker that are in flight at the same time.
+  static constexpr size_t in_flight_per_thread = 4;
+
+  parallel_view(V source, Op op, size_t threads, bool ordered, size_t batch_size)
+          : M_state{std::make_unique<State>(std::move(source), std::move(op), std::max(threads, size_t{1}), ordered,
+                                            batch_size)} {}
+
+  Iterator begin() { return Iterator{M_state.get()}; }
+
+  std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+private:
+  std::unique_ptr<State> M_state;
+};
+
+template<std::ranges::view V, typename Op>
+struct parallel_view<V, Op>::Iterator {
+  using value_type = std::vector<U>;
+  using reference = std::vector<U> &;
+  using difference_type = ptrdiff_t;
+
+  explicit Iterator(State *state) : M_state{state}, M_cur{state->M_next()} {}
+
+  Iterator(Iterator &&o) noexcept
+          : M_state(std::exchange(o.M_state, nullptr)), M_cur(std::exchange(o.M_cur, npos)) {}
+
+  Iterator &
+  operator=(Iterator &&o) noexcept {
+    M_state = std::exchange(o.M_state, nullptr);
+    M_cur = std::exchange(o.M_cur, npos);
+    return *this;
+  }
+
+  friend bool
+  operator==(const Iterator &i, std::default_sentinel_t) noexcept { return i.M_cur == npos; }
+
+  Iterator &
+  operator++() {
+    M_state->M_free.push_back(std::exchange(M_cur, npos));
+    M_cur = M_state->M_next();
+    return *this;
+  }
+
+  void
+  operator++(int) { this->operator++(); }
+
+  reference operator*() const noexcept { return M_state->M_slots[M_cur].M_output; }
+
+private:
+  State *M_state;
+  size_t M_cur;
+};
+
+template<std::ranges::view V, typename Op>
+inline constexpr bool enable_batch_range<parallel_view<V, Op>> = true;
+
+namespace detail {
+template<typename Op>
+struct parallel_stage {
+  Op M_op;
+  size_t M_threads;
+  bool M_ordered;
+  size_t M_batch_size;
+
+  template<std::ranges::viewable_range R>
+  friend auto
+  operator|(R &&source, parallel_stage stage) {
+    using View = std::views::all_t<R>;
+    return parallel_view<View, Op>{std::views::all(std::forward<R>(source)), std::move(stage.M_op),
+                                   stage.M_threads, stage.M_ordered, stage.M_batch_size};
+  }
+};
+} // namespace detail
+
+/// A pipeline stage that applies `f` to every element on `threads` worker
+/// threads, e.g. `iota_gen_batched() | parallel_map(toString, 8)`. `f` is
+/// called concurrently and must be safe to call from several threads.
+/// A source that is not a range of batches (see `enable_batch_range`) is
+/// grouped into batches of `batch_size`.
+template<typename F>
+auto parallel_map(F f, size_t threads = std::thread::hardware_concurrency(), bool ordered = true,
+                  size_t batch_size = 1024) {
+  return detail::parallel_stage<detail::map_op<F>>{{std::move(f)}, threads, ordered, batch_size};
+}
+
+/// A pipeline stage that keeps the elements for which `pred` is true, see
+/// `parallel_map`.
+template<typename P>
+auto parallel_filter(P pred, size_t threads = std::thread::hardware_concurrency(), bool ordered = true,
+                     size_t batch_size = 1024) {
+  return detail::parallel_stage<detail::filter_op<P>>{{std::move(pred)}, threads, ordered, batch_size};
+}
+
+} // namespace batched
+
+#endif //STD_GENERATOR_EXAMPLES_PIPELINE_H
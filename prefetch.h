@@ -0,0 +1,224 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_PREFETCH_H
+#define STD_GENERATOR_EXAMPLES_PREFETCH_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "./batched_generator.h"
+
+namespace batched {
+
+namespace detail {
+// The element type of a range of elements or of a range of batches, see
+// `enable_batch_range`.
+template<typename R>
+struct prefetch_value {
+  using type = std::ranges::range_value_t<R>;
+};
+
+template<typename R> requires enable_batch_range<R>
+struct prefetch_value<R> {
+  using type = std::ranges::range_value_t<std::ranges::range_reference_t<R>>;
+};
+} // namespace detail
+
+/// A range of batches that are produced by a worker thread. The worker
+/// iterates over the source range (a generator of elements or of batches)
+/// and hands complete batches to the consumer over a bounded
+/// single-producer/single-consumer ring, so that production and consumption
+/// overlap. Use `| std::views::join` to consume it element-wise.
+template<typename T>
+class prefetch_view : public std::ranges::view_interface<prefetch_view<T>> {
+  struct State {
+    explicit State(size_t depth) : M_slots(depth) {}
+
+    std::vector<std::vector<T>> M_slots;
+    // The number of batches published by the producer.
+    alignas(64) std::atomic<size_t> M_head{0};
+    // The number of batches released by the consumer.
+    alignas(64) std::atomic<size_t> M_tail{0};
+    alignas(64) std::atomic<bool> M_stop{false};
+    std::exception_ptr M_except;
+
+    std::vector<T> &M_slot(size_t i) noexcept { return M_slots[i % M_slots.size()]; }
+  };
+
+  struct Iterator;
+
+public:
+  template<typename R>
+  prefetch_view(R source, size_t depth, size_t batch_size)
+          : M_state{std::make_unique<State>(std::max(depth, size_t{2}))} {
+    M_thread = std::jthread{[state = M_state.get(), source = std::move(source), batch_size]() mutable {
+      M_produce(*state, source, std::max(batch_size, size_t{1}));
+    }};
+  }
+
+  prefetch_view(prefetch_view &&) noexcept = default;
+
+  prefetch_view &
+  operator=(prefetch_view other) noexcept {
+    std::swap(M_state, other.M_state);
+    std::swap(M_thread, other.M_thread);
+    return *this;
+  }
+
+  ~prefetch_view() {
+    if (!M_thread.joinable()) {
+      return;
+    }
+    // Wake up the producer if it waits for a free slot.
+    M_state->M_stop.store(true);
+    M_state->M_tail.fetch_add(1);
+    M_state->M_tail.notify_one();
+    M_thread.join();
+  }
+
+  Iterator begin() { return Iterator{M_state.get()}; }
+
+  std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+private:
+  template<typename R>
+  static void M_produce(State &st, R &source, size_t batch_size) {
+    const size_t depth = st.M_slots.size();
+    size_t head = 0;
+    st.M_slot(head).reserve(batch_size);
+
+    // Publish the current slot and wait until the next one is free. Returns
+    // false if the consumer has gone away.
+    auto publish = [&]() {
+      st.M_head.store(++head, std::memory_order_release);
+      st.M_head.notify_one();
+      size_t tail;
+      while (head - (tail = st.M_tail.load(std::memory_order_acquire)) >= depth) {
+        if (st.M_stop.load(std::memory_order_relaxed)) {
+          return false;
+        }
+        st.M_tail.wait(tail, std::memory_order_acquire);
+      }
+      if (st.M_stop.load(std::memory_order_relaxed)) {
+        return false;
+      }
+      st.M_slot(head).clear();
+      st.M_slot(head).reserve(batch_size);
+      return true;
+    };
+    auto add = [&](auto &&el) {
+      auto &slot = st.M_slot(head);
+      slot.emplace_back(std::forward<decltype(el)>(el));
+      return slot.size() < batch_size || publish();
+    };
+
+    try {
+      for (auto &&el : source) {
+        if constexpr (enable_batch_range<R>) {
+          for (auto &&inner : el) {
+            if (!add(std::move(inner))) {
+              return;
+            }
+          }
+        } else {
+          if (!add(std::move(el))) {
+            return;
+          }
+        }
+      }
+      if (!st.M_slot(head).empty() && !publish()) {
+        return;
+      }
+    } catch (...) {
+      st.M_except = std::current_exception();
+      st.M_slot(head).clear();
+    }
+    // An empty batch marks the end, there is always room for it.
+    st.M_head.store(++head, std::memory_order_release);
+    st.M_head.notify_one();
+  }
+
+  std::unique_ptr<State> M_state;
+  std::jthread M_thread;
+};
+
+template<typename T>
+struct prefetch_view<T>::Iterator {
+  using value_type = std::vector<T>;
+  using reference = std::vector<T> &;
+  using difference_type = ptrdiff_t;
+
+  explicit Iterator(State *state) : M_state{state} { M_acquire(); }
+
+  Iterator(Iterator &&o) noexcept
+          : M_state(std::exchange(o.M_state, nullptr)), M_cur(std::exchange(o.M_cur, nullptr)) {}
+
+  Iterator &
+  operator=(Iterator &&o) noexcept {
+    M_state = std::exchange(o.M_state, nullptr);
+    M_cur = std::exchange(o.M_cur, nullptr);
+    return *this;
+  }
+
+  friend bool
+  operator==(const Iterator &i, std::default_sentinel_t) noexcept { return i.M_cur == nullptr; }
+
+  Iterator &
+  operator++() {
+    M_state->M_tail.fetch_add(1, std::memory_order_release);
+    M_state->M_tail.notify_one();
+    M_acquire();
+    return *this;
+  }
+
+  void
+  operator++(int) { this->operator++(); }
+
+  reference operator*() const noexcept { return *M_cur; }
+
+private:
+  void M_acquire() {
+    auto tail = M_state->M_tail.load(std::memory_order_relaxed);
+    size_t head;
+    while ((head = M_state->M_head.load(std::memory_order_acquire)) == tail) {
+      M_state->M_head.wait(head, std::memory_order_acquire);
+    }
+    M_cur = &M_state->M_slot(tail);
+    if (M_cur->empty()) {
+      M_cur = nullptr;
+      if (auto e = M_state->M_except) {
+        std::rethrow_exception(e);
+      }
+    }
+  }
+
+  State *M_state;
+  std::vector<T> *M_cur = nullptr;
+};
+
+template<typename T>
+inline constexpr bool enable_batch_range<prefetch_view<T>> = true;
+
+/// Run `source` on a worker thread that stays up to `depth` batches of
+/// `batch_size` elements ahead of the consumer. `source` is a range of
+/// elements or a range of batches (e.g. a `batched::generator`, see
+/// `enable_batch_range`).
+template<std::ranges::input_range R>
+auto prefetch(R &&source, size_t depth = 4, size_t batch_size = 1024) {
+  using T = typename detail::prefetch_value<std::remove_cvref_t<R>>::type;
+  return prefetch_view<T>{std::views::all(std::forward<R>(source)), depth, batch_size};
+}
+
+} // namespace batched
+
+#endif //STD_GENERATOR_EXAMPLES_PREFETCH_H
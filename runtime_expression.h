@@ -0,0 +1,218 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_RUNTIME_EXPRESSION_H
+#define STD_GENERATOR_EXAMPLES_RUNTIME_EXPRESSION_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <generator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./binary_expression.h"
+
+// Binary expressions whose operator is only known at runtime, e.g. from a
+// query plan. `::binaryExpression` is instantiated once per functor type,
+// here all operators share the same code and a table of precompiled
+// kernels, indexed by the operator and the kinds of the two operands, is
+// consulted once per `Arg` instead of once per element.
+namespace runtime {
+
+enum class OpCode : uint8_t { Plus, Minus, Multiplies, Divides, Min, Max };
+constexpr size_t NUM_OP_CODES = 6;
+
+// Whether an `Arg` is a scalar or a vector, the same as `Arg::index()`.
+enum class Kind : uint8_t { Scalar, Vector };
+constexpr size_t NUM_KINDS = 2;
+
+// Compute `out[i] = op(lhs[i], rhs[i])` for `i` in `[0, n)`. A scalar
+// operand points to its single value, which is broadcast.
+using Kernel = void (*)(const double* lhs, const double* rhs, double* out, size_t n);
+
+// The functor for each `OpCode`, and the `OpCode` for each functor.
+template <OpCode Op>
+struct Functor;
+template <>
+struct Functor<OpCode::Plus> : std::type_identity<std::plus<>> {};
+template <>
+struct Functor<OpCode::Minus> : std::type_identity<std::minus<>> {};
+template <>
+struct Functor<OpCode::Multiplies> : std::type_identity<std::multiplies<>> {};
+template <>
+struct Functor<OpCode::Divides> : std::type_identity<std::divides<>> {};
+template <>
+struct Functor<OpCode::Min> : std::type_identity<std::remove_cvref_t<decltype(std::ranges::min)>> {};
+template <>
+struct Functor<OpCode::Max> : std::type_identity<std::remove_cvref_t<decltype(std::ranges::max)>> {};
+
+template <typename F>
+constexpr OpCode opCodeOf() {
+    using G = std::remove_cvref_t<F>;
+    if constexpr (std::same_as<G, std::plus<>> || std::same_as<G, std::plus<double>>) {
+        return OpCode::Plus;
+    } else if constexpr (std::same_as<G, std::minus<>> || std::same_as<G, std::minus<double>>) {
+        return OpCode::Minus;
+    } else if constexpr (std::same_as<G, std::multiplies<>> || std::same_as<G, std::multiplies<double>>) {
+        return OpCode::Multiplies;
+    } else if constexpr (std::same_as<G, std::divides<>> || std::same_as<G, std::divides<double>>) {
+        return OpCode::Divides;
+    } else if constexpr (std::same_as<G, Functor<OpCode::Min>::type>) {
+        return OpCode::Min;
+    } else {
+        static_assert(std::same_as<G, Functor<OpCode::Max>::type>, "There is no OpCode for this functor");
+        return OpCode::Max;
+    }
+}
+
+namespace detail {
+template <Kind K>
+auto operand(const double* ptr) {
+    if constexpr (K == Kind::Scalar) {
+        return kernels::Scalar<double>{*ptr};
+    } else {
+        return kernels::Column<double>{ptr};
+    }
+}
+
+template <OpCode Op, Kind L, Kind R>
+void kernel(const double* lhs, const double* rhs, double* out, size_t n) {
+    kernels::evaluate(typename Functor<Op>::type{}, operand<L>(lhs), operand<R>(rhs), out, n);
+}
+
+constexpr size_t tableIndex(OpCode op, Kind lhs, Kind rhs) {
+    return (static_cast<size_t>(op) * NUM_KINDS + static_cast<size_t>(lhs)) * NUM_KINDS + static_cast<size_t>(rhs);
+}
+
+constexpr auto makeKernelTable() {
+    std::array<Kernel, NUM_OP_CODES * NUM_KINDS * NUM_KINDS> table{};
+    auto add = [&table]<size_t... Ops>(std::index_sequence<Ops...>) {
+        ((table[tableIndex(OpCode(Ops), Kind::Scalar, Kind::Scalar)] = &kernel<OpCode(Ops), Kind::Scalar, Kind::Scalar>,
+          table[tableIndex(OpCode(Ops), Kind::Scalar, Kind::Vector)] = &kernel<OpCode(Ops), Kind::Scalar, Kind::Vector>,
+          table[tableIndex(OpCode(Ops), Kind::Vector, Kind::Scalar)] = &kernel<OpCode(Ops), Kind::Vector, Kind::Scalar>,
+          table[tableIndex(OpCode(Ops), Kind::Vector, Kind::Vector)] = &kernel<OpCode(Ops), Kind::Vector, Kind::Vector>),
+         ...);
+    };
+    add(std::make_index_sequence<NUM_OP_CODES>{});
+    return table;
+}
+
+inline constexpr auto KERNELS = makeKernelTable();
+
+inline Kind kind(const Arg& arg) { return static_cast<Kind>(arg.index()); }
+
+inline const double* data(const Arg& arg) {
+    if (auto vec = std::get_if<std::vector<double>>(&arg)) {
+        return vec->data();
+    }
+    return std::get_if<double>(&arg);
+}
+
+// Run `kernel`, split across threads for large results like `evaluateKernel`.
+inline void run(Kernel kernel, const Arg& arg1, const Arg& arg2, double* out, size_t n) {
+    const double* lhs = data(arg1);
+    const double* rhs = data(arg2);
+    const auto& config = parallelConfig();
+    if (n < config.threshold) {
+        kernel(lhs, rhs, out, n);
+        return;
+    }
+    auto& pool = config.pool ? *config.pool : ThreadPool::global();
+    const bool lhsVector = kind(arg1) == Kind::Vector;
+    const bool rhsVector = kind(arg2) == Kind::Vector;
+    pool.parallelFor(n, 1024, [&](size_t begin, size_t end) {
+        kernel(lhsVector ? lhs + begin : lhs, rhsVector ? rhs + begin : rhs, out + begin, end - begin);
+    });
+}
+}  // namespace detail
+
+// The kernel for `op` on operands of the given kinds.
+inline Kernel kernelFor(OpCode op, Kind lhs, Kind rhs) {
+    if (static_cast<size_t>(op) >= NUM_OP_CODES) {
+        throw std::invalid_argument{"Unknown OpCode " + std::to_string(static_cast<int>(op))};
+    }
+    return detail::KERNELS[detail::tableIndex(op, lhs, rhs)];
+}
+
+// The same as `::evaluateBinaryExpression(arg1, arg2, f)` for the functor
+// `f` that corresponds to `op`.
+inline Arg evaluateBinaryExpression(const Arg& arg1, const Arg& arg2, OpCode op) {
+    const Kernel kernel = kernelFor(op, detail::kind(arg1), detail::kind(arg2));
+    const bool scalars = detail::kind(arg1) == Kind::Scalar && detail::kind(arg2) == Kind::Scalar;
+    // A scalar broadcasts to an empty vector, too, so only a result of
+    // exactly one element is a scalar.
+    const size_t resultSize = scalars ? 1 : getResultSize(arg1, arg2);
+    if (resultSize == 1) {
+        double res;
+        kernel(detail::data(arg1), detail::data(arg2), &res, 1);
+        return Arg{res};
+    }
+    auto res = ArgBufferPool::local().acquire(resultSize);
+    detail::run(kernel, arg1, arg2, res.data(), resultSize);
+    return res;
+}
+
+// Like above, but the result is computed in place in the buffer of one of
+// the operands if possible, as in `::evaluateBinaryExpression(Arg&&, ...)`.
+inline Arg evaluateBinaryExpression(Arg&& arg1, Arg&& arg2, OpCode op) {
+    const size_t resultSize = getResultSize(arg1, arg2);
+    Arg* target = nullptr;
+    if (resultSize != 1) {
+        target = detail::kind(arg1) == Kind::Vector ? &arg1 : &arg2;
+    }
+    if (target == nullptr) {
+        auto res = evaluateBinaryExpression(std::as_const(arg1), std::as_const(arg2), op);
+        recycle(std::move(arg1));
+        recycle(std::move(arg2));
+        return res;
+    }
+    const Kernel kernel = kernelFor(op, detail::kind(arg1), detail::kind(arg2));
+    detail::run(kernel, arg1, arg2, std::get<std::vector<double>>(*target).data(), resultSize);
+    recycle(std::move(target == &arg1 ? arg2 : arg1));
+    return std::move(*target);
+}
+
+// One generator type for all operators, so that trees of any shape can be
+// built at runtime without instantiating a template per node.
+inline Exp binaryExpression(Exp exp1, Exp exp2, OpCode op) {
+    for (auto&& [arg1, arg2] : std::views::zip(std::move(exp1), std::move(exp2))) {
+        co_yield evaluateBinaryExpression(std::move(arg1), std::move(arg2), op);
+    }
+}
+
+// A tree of operations that is only known at runtime. A leaf refers to one
+// of the `inputs` of `build` by its index.
+struct Plan {
+    OpCode op = OpCode::Plus;
+    std::vector<Plan> children{};
+    size_t input = 0;
+
+    static Plan leaf(size_t input) { return Plan{.input = input}; }
+
+    static Plan node(OpCode op, Plan lhs, Plan rhs) {
+        Plan plan{.op = op};
+        plan.children.push_back(std::move(lhs));
+        plan.children.push_back(std::move(rhs));
+        return plan;
+    }
+};
+
+// The generator that evaluates `plan`. Every input must be used at most
+// once, it is moved out of `inputs`.
+inline Exp build(const Plan& plan, std::vector<Exp>& inputs) {
+    if (plan.children.empty()) {
+        return std::move(inputs.at(plan.input));
+    }
+    auto lhs = build(plan.children[0], inputs);
+    auto rhs = build(plan.children[1], inputs);
+    return binaryExpression(std::move(lhs), std::move(rhs), plan.op);
+}
+
+}  // namespace runtime
+
+#endif //STD_GENERATOR_EXAMPLES_RUNTIME_EXPRESSION_H
@@ -29,18 +29,31 @@
 #pragma once
 
 #include <ranges>
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
 
 #include <type_traits>
 #include <concepts>
 #include <utility>
 
+#include "./generator_instrumentation.h"
+#include "./generator_stop.h"
+
 namespace custom {
 using namespace std;
 
+using generator_stop::stop_token;
+using generator_stop::get_stop_token;
+
 /** @brief A range specified using a yielding coroutine.
  *
  * `std::generator` is a utility class for defining ranges using coroutines
@@ -49,7 +62,7 @@ using namespace std;
  * @headerfile generator
  * @since C++23
  */
-template<typename Ref, typename Val = void>
+template<typename Ref, typename Val = void, typename Alloc = void>
 class generator;
 
 namespace gen {
@@ -58,6 +71,17 @@ namespace gen {
 template<typename Ref, typename Val>
 using Reference_t = conditional_t<is_void_v<Val>, Ref &&, Ref>;
 
+/// Type of the values yielded by a generator<Ref, Val>.
+template<typename Ref, typename Val>
+using Yield2_t = conditional_t<is_reference_v<Reference_t<Ref, Val>>,
+        Reference_t<Ref, Val>,
+        const Reference_t<Ref, Val> &>;
+
+template<typename>
+constexpr bool Is_generator = false;
+template<typename Val, typename Ref, typename Alloc>
+constexpr bool Is_generator<custom::generator<Val, Ref, Alloc>> = true;
+
 /// Allocator and value type erased generator promise type.
 /// \tparam Yielded The corresponding generators yielded type.
 template<typename Yielded>
@@ -66,18 +90,42 @@ class Promise_erased {
   using Yielded_deref = remove_reference_t<Yielded>;
   using Yielded_decvref = remove_cvref_t<Yielded>;
   using ValuePtr = add_pointer_t<Yielded>;
+  using Coro_handle = std::coroutine_handle<Promise_erased>;
 
-  template<typename, typename>
+  template<typename, typename, typename>
   friend
   class custom::generator;
 
+  template<typename Gen>
+  struct Recursive_awaiter;
+  struct Final_awaiter;
+  struct Yield_awaiter;
   struct Copy_awaiter;
+  struct Subyield_state;
+
+  // Whether a yielded value can be written to the sink of `next_batch`. A
+  // generator of mutable references hands out the producer's objects, for
+  // those a copy would have different semantics.
+  static constexpr bool Sink_assignable = (!is_lvalue_reference_v<Yielded> || is_const_v<Yielded_deref>)
+                                          && is_assignable_v<Yielded_decvref &, Yielded>;
 public:
   suspend_always initial_suspend() const noexcept { return {}; }
 
-  suspend_always yield_value(Yielded val) noexcept {
-    M_value() = std::addressof(val);
-    return {};
+  /// Only suspends if the value has to be handed to the iterator or the
+  /// sink of `next_batch` is full.
+  Yield_awaiter
+  yield_value(Yielded val)
+  noexcept(is_nothrow_assignable_v<Yielded_decvref &, Yielded>) {
+    GENERATOR_RECORD_YIELD();
+    auto &bottom = M_nest.M_bottom_state();
+    if constexpr (Sink_assignable) {
+      if (bottom.M_sink_) {
+        *bottom.M_sink_++ = static_cast<Yielded>(val);
+        return {bottom.M_sink_ == bottom.M_sink_end_};
+      }
+    }
+    bottom.M_value_ = std::addressof(val);
+    return {true};
   }
 
   auto
@@ -85,47 +133,446 @@ public:
   noexcept(is_nothrow_constructible_v<Yielded_decvref,
           const Yielded_deref &>) requires (is_rvalue_reference_v<Yielded>
                                             && constructible_from<Yielded_decvref,
-          const Yielded_deref &>) { return Copy_awaiter(val, M_value()); }
+          const Yielded_deref &>) {
+    GENERATOR_RECORD_YIELD();
+    auto &bottom = M_nest.M_bottom_state();
+    if constexpr (Sink_assignable) {
+      if (bottom.M_sink_) {
+        if constexpr (is_copy_assignable_v<Yielded_decvref>)
+          *bottom.M_sink_++ = val;
+        else
+          *bottom.M_sink_++ = Yielded_decvref(val);
+        return Copy_awaiter{nullopt, bottom.M_value_, bottom.M_sink_ == bottom.M_sink_end_};
+      }
+    }
+    return Copy_awaiter{in_place, bottom.M_value_, val};
+  }
 
-  std::suspend_always
+  template<typename R2, typename V2, typename A2, typename U2>
+  requires std::same_as<Yield2_t<R2, V2>, Yielded>
+  auto
+  yield_value(ranges::elements_of<generator<R2, V2, A2> &&, U2> r)
+  noexcept { return Recursive_awaiter<generator<R2, V2, A2>>{std::move(r.range)}; }
+
+  template<ranges::input_range R, typename Alloc>
+  requires convertible_to<ranges::range_reference_t<R>, Yielded>
+  auto
+  yield_value(ranges::elements_of<R, Alloc> r) {
+    auto n = [](allocator_arg_t, Alloc,
+                ranges::iterator_t<R> i,
+                ranges::sentinel_t<R> s)
+            -> generator<Yielded, ranges::range_value_t<R>, Alloc> {
+      for (; i != s; ++i)
+        co_yield static_cast<Yielded>(*i);
+    };
+    return yield_value(ranges::elements_of(n(allocator_arg, r.allocator,
+                                             ranges::begin(r.range),
+                                             ranges::end(r.range))));
+  }
+
+  Final_awaiter
   final_suspend() noexcept { return {}; }
 
+  /// The bottom frame lets the exception escape from `resume()`, i.e. from
+  /// `begin()`, `operator++` or `next_batch` of the consumer, and is then
+  /// done. A nested frame stores it for `Recursive_awaiter`, which rethrows
+  /// it in the parent.
   void unhandled_exception() {
+    if (M_nest.M_is_bottom())
+      throw;
     this->M_except = std::current_exception();
   }
 
   void await_transform() = delete;
 
+  /// `co_await` of a `custom::task` (see task.h), or anything else with a
+  /// nested `blocking_awaiter`. The generator is not suspended, the awaiter
+  /// completes the work while the consumer waits.
+  template<typename A>
+  requires requires { typename std::remove_cvref_t<A>::blocking_awaiter; }
+  typename std::remove_cvref_t<A>::blocking_awaiter
+  await_transform(A &&a) { return {std::forward<A>(a)}; }
+
+  /// `co_await get_stop_token`, nested frames share the token of the bottom.
+  generator_stop::stop_token_awaiter
+  await_transform(generator_stop::get_stop_token_t) noexcept {
+    return {stop_token{M_nest.M_bottom_state().M_stop_}};
+  }
+
   void return_void() const noexcept {}
 
 private:
-  ValuePtr &M_value() noexcept { return M_value_; }
+  ValuePtr &M_bottom_value() noexcept { return M_nest.M_bottom_value(); }
 
-  ValuePtr M_value_ = nullptr;
+  ValuePtr &M_value() noexcept { return M_nest.M_value_; }
+
+  Subyield_state M_nest;
   std::exception_ptr M_except;
 };
 
+/// The stack of generators that are currently nested via `elements_of`.
+/// The bottom (outermost) frame stores the innermost active frame, which
+/// is resumed directly by the iterator, and the value that was yielded
+/// last. Every nested frame points to the bottom frame and to its parent.
+/// During `next_batch` the bottom frame also stores the free part of the
+/// caller's span, into which all frames write their values directly, and
+/// it holds the stop flag of the whole stack.
+template<typename Yielded>
+struct Promise_erased<Yielded>::Subyield_state {
+  Coro_handle M_top_;
+  ValuePtr M_value_ = nullptr;
+  Yielded_decvref *M_sink_ = nullptr;
+  Yielded_decvref *M_sink_end_ = nullptr;
+  std::atomic<bool> M_stop_{false};
+  Coro_handle M_bottom_;
+  Coro_handle M_parent_;
+
+  bool
+  M_is_bottom() const noexcept { return !M_bottom_; }
+
+  Coro_handle &
+  M_top() noexcept {
+    if (M_is_bottom())
+      return M_top_;
+    return M_bottom_.promise().M_nest.M_top_;
+  }
+
+  void
+  M_push(Coro_handle current, Coro_handle subyield) noexcept {
+    subyield.promise().M_nest.M_jump_in(current, subyield);
+  }
+
+  std::coroutine_handle<>
+  M_pop() noexcept {
+    if (M_is_bottom())
+      return std::noop_coroutine();
+    return M_top() = M_parent_;
+  }
+
+  void
+  M_jump_in(Coro_handle rest, Coro_handle new_top) noexcept {
+    auto &rn = rest.promise().M_nest;
+    rn.M_top() = new_top;
+    M_bottom_ = rn.M_is_bottom() ? rest : rn.M_bottom_;
+    M_parent_ = rest;
+  }
+
+  Subyield_state &
+  M_bottom_state() noexcept {
+    if (M_is_bottom())
+      return *this;
+    return M_bottom_.promise().M_nest;
+  }
+
+  ValuePtr &
+  M_bottom_value() noexcept { return M_bottom_state().M_value_; }
+};
+
+template<typename Yielded>
+struct Promise_erased<Yielded>::Final_awaiter {
+  bool await_ready() noexcept { return false; }
+
+  template<typename Promise>
+  std::coroutine_handle<>
+  await_suspend(std::coroutine_handle<Promise> c) noexcept {
+    // Continue with the parent of a nested generator without going
+    // through the iterator.
+    if (!c.promise().M_nest.M_is_bottom())
+      GENERATOR_RECORD_RESUME();
+    return c.promise().M_nest.M_pop();
+  }
+
+  void await_resume() noexcept {}
+};
+
+/// Continues the coroutine without suspending it if `M_suspend` is false.
+/// Deciding this in `await_suspend` instead of `await_ready` keeps the
+/// element-wise path as fast as with `suspend_always`.
+template<typename Yielded>
+struct Promise_erased<Yielded>::Yield_awaiter {
+  bool M_suspend;
+
+  constexpr bool await_ready() const noexcept { return false; }
+
+  constexpr bool await_suspend(std::coroutine_handle<>) const noexcept { return M_suspend; }
+
+  constexpr void await_resume() const noexcept {}
+};
+
+/// Holds a copy of a yielded lvalue while the consumer may move from it.
+/// The copy is not needed if the value was written to a sink.
 template<typename Yielded>
 struct Promise_erased<Yielded>::Copy_awaiter {
-  Yielded_decvref M_value;
+  optional<Yielded_decvref> M_value;
   ValuePtr &M_bottom_value;
+  bool M_suspend = true;
+
+  Copy_awaiter(nullopt_t, ValuePtr &bottom_value, bool suspend) noexcept
+          : M_bottom_value(bottom_value), M_suspend(suspend) {}
 
-  constexpr bool await_ready() noexcept { return false; }
+  Copy_awaiter(in_place_t, ValuePtr &bottom_value, const Yielded_deref &val)
+          : M_value(in_place, val), M_bottom_value(bottom_value) {}
+
+  constexpr bool await_ready() const noexcept { return false; }
 
   template<typename Promise>
-  void await_suspend(std::coroutine_handle<Promise>) noexcept {
-    M_bottom_value = ::std::addressof(M_value);
+  bool await_suspend(std::coroutine_handle<Promise>) noexcept {
+    if (M_value)
+      M_bottom_value = ::std::addressof(*M_value);
+    return M_suspend;
   }
 
   constexpr void
   await_resume() const noexcept {}
 };
 
+template<typename Yielded>
+template<typename Gen>
+struct Promise_erased<Yielded>::Recursive_awaiter {
+  Gen M_gen;
+  static_assert(Is_generator<Gen>);
+  static_assert(std::same_as<typename Gen::yielded, Yielded>);
+
+  constexpr bool await_ready() const noexcept { return false; }
+
+  template<typename Promise>
+  std::coroutine_handle<>
+  await_suspend(std::coroutine_handle<Promise> p) noexcept {
+    // Make the nested generator the top of the stack and transfer control
+    // to it directly.
+    auto c = Coro_handle::from_address(p.address());
+    auto t = Coro_handle::from_address(this->M_gen.M_coro.address());
+    p.promise().M_nest.M_push(c, t);
+    GENERATOR_RECORD_RESUME();
+    return t;
+  }
+
+  void await_resume() {
+    if (auto e = M_gen.M_coro.promise().M_except)
+      std::rethrow_exception(e);
+  }
+};
+
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Alloc_block {
+  unsigned char M_data[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+
+  static auto
+  M_cnt(std::size_t sz) noexcept {
+    auto blksz = sizeof(Alloc_block);
+    return (sz + blksz - 1) / blksz;
+  }
+};
+
+template<typename A>
+concept Stateless_alloc = (allocator_traits<A>::is_always_equal::value
+                           && default_initializable<A>);
+
+/// Frame allocation for a generator whose allocator is known statically.
+/// A stateful allocator is stored right behind the coroutine frame.
+template<typename Alloc>
+class Promise_alloc {
+  using ATr = allocator_traits<Alloc>;
+  using Rebound = typename ATr::template rebind_alloc<Alloc_block>;
+  using Rebound_ATr = typename ATr::template rebind_traits<Alloc_block>;
+  static_assert(is_pointer_v<typename Rebound_ATr::pointer>,
+                "Must use allocators for true pointers with generators");
+
+  static auto
+  M_alloc_address(std::uintptr_t fn, std::uintptr_t fsz) noexcept {
+    auto an = fn + fsz;
+    auto ba = alignof(Rebound);
+    return reinterpret_cast<Rebound *>(((an + ba - 1) / ba) * ba);
+  }
+
+  static auto
+  M_alloc_size(std::size_t csz) noexcept {
+    auto ba = alignof(Rebound);
+    // Our desired layout is placing the coroutine frame, then pad out to
+    // align, then place the allocator.  The total size of that is the size
+    // of the coroutine frame, plus up to ba bytes, plus the size of the
+    // allocator.
+    return csz + ba + sizeof(Rebound);
+  }
+
+  static void *
+  M_allocate(Rebound b, std::size_t csz) {
+    GENERATOR_RECORD_FRAME_ALLOC(csz);
+    if constexpr (Stateless_alloc<Rebound>)
+      // Only need room for the coroutine.
+      return b.allocate(Alloc_block::M_cnt(csz));
+    else {
+      auto nsz = Alloc_block::M_cnt(M_alloc_size(csz));
+      auto f = b.allocate(nsz);
+      auto fn = reinterpret_cast<std::uintptr_t>(f);
+      auto an = M_alloc_address(fn, csz);
+      ::new(an) Rebound(std::move(b));
+      return f;
+    }
+  }
+
+public:
+  void *
+  operator new(std::size_t sz)
+  requires default_initializable<Rebound> { return M_allocate({}, sz); }
+
+  template<typename Na, typename... Args>
+  void *
+  operator new(std::size_t sz, allocator_arg_t, const Na &na, const Args &...)
+  requires convertible_to<const Na &, Alloc> {
+    return M_allocate(static_cast<Rebound>(static_cast<Alloc>(na)), sz);
+  }
+
+  template<typename This, typename Na, typename... Args>
+  void *
+  operator new(std::size_t sz, const This &, allocator_arg_t, const Na &na,
+               const Args &...)
+  requires convertible_to<const Na &, Alloc> {
+    return M_allocate(static_cast<Rebound>(static_cast<Alloc>(na)), sz);
+  }
+
+  void
+  operator delete(void *ptr, std::size_t csz) noexcept {
+    GENERATOR_RECORD_FRAME_DEALLOC();
+    if constexpr (Stateless_alloc<Rebound>) {
+      Rebound b;
+      return b.deallocate(reinterpret_cast<Alloc_block *>(ptr),
+                          Alloc_block::M_cnt(csz));
+    } else {
+      auto nsz = Alloc_block::M_cnt(M_alloc_size(csz));
+      auto fn = reinterpret_cast<std::uintptr_t>(ptr);
+      auto an = M_alloc_address(fn, csz);
+      Rebound b(std::move(*an));
+      an->~Rebound();
+      b.deallocate(reinterpret_cast<Alloc_block *>(ptr), nsz);
+    }
+  }
+};
+
+/// Frame allocation for a generator with a type-erased allocator.  The
+/// deallocation function (and a stateful allocator) are stored right behind
+/// the coroutine frame, so any allocator can be passed via allocator_arg.
+template<>
+class Promise_alloc<void> {
+  using Dealloc_fn = void (*)(void *, std::size_t);
+
+  static auto
+  M_dealloc_address(std::uintptr_t fn, std::uintptr_t fsz) noexcept {
+    auto an = fn + fsz;
+    auto ba = alignof(Dealloc_fn);
+    auto aligned = ((an + ba - 1) / ba) * ba;
+    return reinterpret_cast<Dealloc_fn *>(aligned);
+  }
+
+  template<typename Rebound>
+  static auto
+  M_alloc_address(std::uintptr_t fn, std::uintptr_t fsz) noexcept
+  requires (!Stateless_alloc<Rebound>) {
+    auto ba = alignof(Rebound);
+    auto da = M_dealloc_address(fn, fsz);
+    auto aan = reinterpret_cast<std::uintptr_t>(da);
+    aan += sizeof(Dealloc_fn);
+    auto aligned = ((aan + ba - 1) / ba) * ba;
+    return reinterpret_cast<Rebound *>(aligned);
+  }
+
+  template<typename Rebound>
+  static auto
+  M_alloc_size(std::size_t csz) noexcept {
+    // This time, we want the coroutine frame, then the deallocator
+    // pointer, then the allocator itself, if any.
+    std::size_t aa = 0;
+    std::size_t as = 0;
+    if constexpr (!std::same_as<Rebound, void>) {
+      aa = alignof(Rebound);
+      as = sizeof(Rebound);
+    }
+    auto ba = aa + alignof(Dealloc_fn);
+    return csz + ba + as + sizeof(Dealloc_fn);
+  }
+
+  template<typename Rebound>
+  static void
+  M_deallocator(void *ptr, std::size_t csz) noexcept {
+    auto asz = M_alloc_size<Rebound>(csz);
+    auto nblk = Alloc_block::M_cnt(asz);
+
+    if constexpr (Stateless_alloc<Rebound>) {
+      Rebound b;
+      b.deallocate(reinterpret_cast<Alloc_block *>(ptr), nblk);
+    } else {
+      auto fn = reinterpret_cast<std::uintptr_t>(ptr);
+      auto an = M_alloc_address<Rebound>(fn, csz);
+      Rebound b(std::move(*an));
+      an->~Rebound();
+      b.deallocate(reinterpret_cast<Alloc_block *>(ptr), nblk);
+    }
+  }
+
+  template<typename Na>
+  static void *
+  M_allocate(const Na &na, std::size_t csz) {
+    using Rebound = typename allocator_traits<Na>::template rebind_alloc<Alloc_block>;
+    using Rebound_ATr = typename allocator_traits<Na>::template rebind_traits<Alloc_block>;
+
+    static_assert(is_pointer_v<typename Rebound_ATr::pointer>,
+                  "Must use allocators for true pointers with generators");
+
+    GENERATOR_RECORD_FRAME_ALLOC(csz);
+    Dealloc_fn d = &M_deallocator<Rebound>;
+    auto b = static_cast<Rebound>(na);
+    auto asz = M_alloc_size<Rebound>(csz);
+    auto nblk = Alloc_block::M_cnt(asz);
+    void *p = b.allocate(nblk);
+    auto pn = reinterpret_cast<std::uintptr_t>(p);
+    *M_dealloc_address(pn, csz) = d;
+    if constexpr (!Stateless_alloc<Rebound>) {
+      auto an = M_alloc_address<Rebound>(pn, csz);
+      ::new(an) Rebound(std::move(b));
+    }
+    return p;
+  }
+
+public:
+  void *
+  operator new(std::size_t sz) {
+    GENERATOR_RECORD_FRAME_ALLOC(sz);
+    auto nsz = M_alloc_size<void>(sz);
+    Dealloc_fn d = [](void *ptr, std::size_t sz) {
+      ::operator delete(ptr, M_alloc_size<void>(sz));
+    };
+    auto p = ::operator new(nsz);
+    auto pn = reinterpret_cast<std::uintptr_t>(p);
+    *M_dealloc_address(pn, sz) = d;
+    return p;
+  }
+
+  template<typename Na, typename... Args>
+  void *
+  operator new(std::size_t sz, allocator_arg_t, const Na &na, const Args &...) {
+    return M_allocate(na, sz);
+  }
+
+  template<typename This, typename Na, typename... Args>
+  void *
+  operator new(std::size_t sz, const This &, allocator_arg_t, const Na &na,
+               const Args &...) {
+    return M_allocate(na, sz);
+  }
+
+  void
+  operator delete(void *ptr, std::size_t sz) noexcept {
+    GENERATOR_RECORD_FRAME_DEALLOC();
+    auto pn = reinterpret_cast<std::uintptr_t>(ptr);
+    Dealloc_fn d = *M_dealloc_address(pn, sz);
+    d(ptr, sz);
+  }
+};
+
 } // namespace gen
 /// @endcond
 
-template<typename Ref, typename Val>
-class generator : public ranges::view_interface<generator<Ref, Val>> {
+template<typename Ref, typename Val, typename Alloc>
+class generator : public ranges::view_interface<generator<Ref, Val, Alloc>> {
   using Value = conditional_t<is_void_v<Val>, remove_cvref_t<Ref>, Val>;
   using Reference = gen::Reference_t<Ref, Val>;
 
@@ -135,8 +582,13 @@ class generator : public ranges::view_interface<generator<Ref, Val>> {
 
   struct Iterator;
 
+  template<typename>
+  friend class gen::Promise_erased;
+
 public:
-  struct promise_type : Erased_promise {
+  using yielded = Yielded;
+
+  struct promise_type : Erased_promise, gen::Promise_alloc<Alloc> {
     generator get_return_object() noexcept { return {coroutine_handle<promise_type>::from_promise(*this)}; }
   };
 
@@ -162,6 +614,70 @@ public:
 
   std::default_sentinel_t end() const noexcept { return default_sentinel; }
 
+  /// The type of the elements that `next_batch` writes.
+  using batch_value_type = remove_cvref_t<Yielded>;
+
+  /// Run the coroutine until `out` is full or it finishes, and write the
+  /// yielded values directly into `out`. In between, the coroutine is not
+  /// suspended, so a batch costs one resumption instead of one per element,
+  /// also for nested generators. Returns the number of elements written,
+  /// which is only less than `out.size()` at the end. Can be mixed with
+  /// iteration, the batch starts after the element the iterator points to.
+  /// If the coroutine throws, the elements before the exception are
+  /// returned first and the exception is thrown by the next call.
+  size_t
+  next_batch(std::span<batch_value_type> out)
+  requires Erased_promise::Sink_assignable {
+    auto &p = M_coro.promise();
+    auto &bottom = p.M_nest;
+    if (auto e = std::exchange(p.M_except, nullptr))
+      std::rethrow_exception(e);
+    if (!bottom.M_top_)
+      bottom.M_top_ = Coro_handle::from_promise(p);
+    if (out.empty() || M_coro.done())
+      return 0;
+    bottom.M_sink_ = out.data();
+    bottom.M_sink_end_ = out.data() + out.size();
+    auto finish = [&] {
+      size_t n = bottom.M_sink_ - out.data();
+      bottom.M_sink_ = bottom.M_sink_end_ = nullptr;
+      return n;
+    };
+    GENERATOR_RECORD_RESUME();
+    try {
+      bottom.M_top_.resume();
+    } catch (...) {
+      size_t n = finish();
+      if (n == 0)
+        throw;
+      p.M_except = std::current_exception();
+      return n;
+    }
+    return finish();
+  }
+
+  /// Call `f` with a contiguous `std::span<batch_value_type>` of up to
+  /// `batch_size` elements until the generator is exhausted, see
+  /// `next_batch`. The elements may be moved from.
+  template<typename F>
+  void
+  for_each_batch(F f, size_t batch_size = 1024)
+  requires Erased_promise::Sink_assignable {
+    std::vector<batch_value_type> buffer(std::max(batch_size, size_t{1}));
+    while (size_t n = next_batch(buffer)) {
+      std::invoke(f, std::span<batch_value_type>{buffer.data(), n});
+    }
+  }
+
+  /// Ask the coroutine to finish, see `generator_stop.h`. It is only
+  /// checked by coroutines that use `co_await get_stop_token`, the others
+  /// run on until they are destroyed together with the generator.
+  void
+  request_stop() noexcept { M_coro.promise().M_nest.M_stop_.store(true, std::memory_order_relaxed); }
+
+  bool
+  stop_requested() const noexcept { return M_coro.promise().M_nest.M_stop_.load(std::memory_order_relaxed); }
+
 private:
   using Coro_handle = std::coroutine_handle<Erased_promise>;
 
@@ -171,8 +687,8 @@ private:
   coroutine_handle<promise_type> M_coro;
 };
 
-template<class Ref, class Val>
-struct generator<Ref, Val>::Iterator {
+template<class Ref, class Val, class Alloc>
+struct generator<Ref, Val, Alloc>::Iterator {
   using value_type = Value;
   using difference_type = ptrdiff_t;
 
@@ -181,6 +697,10 @@ struct generator<Ref, Val>::Iterator {
 
   friend class generator;
 
+  /// Only to be assigned to, e.g. by `std::views::join` over a range of
+  /// generators.
+  Iterator() = default;
+
   Iterator(Iterator &&o) noexcept
           : M_coro(std::exchange(o.M_coro, {})) {}
 
@@ -192,7 +712,7 @@ struct generator<Ref, Val>::Iterator {
 
   Iterator &
   operator++() {
-    M_coro.resume();
+    M_next();
     return *this;
   }
 
@@ -210,7 +730,18 @@ private:
   friend class generator;
 
   Iterator(Coro_handle g)
-          : M_coro{g} { M_coro.resume(); }
+          : M_coro{g} {
+    // The coroutine may already have been started by `next_batch`.
+    if (!M_coro.promise().M_nest.M_top_)
+      M_coro.promise().M_nest.M_top_ = M_coro;
+    M_next();
+  }
+
+  void M_next() {
+    // Resume the innermost nested generator, independent of the depth.
+    GENERATOR_RECORD_RESUME();
+    M_coro.promise().M_nest.M_top_.resume();
+  }
 
   Coro_handle M_coro;
 };
@@ -0,0 +1,146 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_STREAMING_EXPRESSION_H
+#define STD_GENERATOR_EXAMPLES_STREAMING_EXPRESSION_H
+
+#include <algorithm>
+#include <generator>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "./expression_kernels.h"
+#include "./mapped_file.h"
+
+// Binary expressions over columns that are streamed in fixed-size chunks.
+// Every stage keeps a single reusable buffer, so the resident memory does
+// not depend on the length of the columns.
+namespace streaming {
+
+// The default number of elements per chunk.
+constexpr static size_t CHUNK_SIZE = 4096;
+
+// A chunk of a column, or a scalar that is broadcast to every chunk of the
+// other operand. A span stays valid until the generator is resumed.
+using Chunk = std::variant<double, std::span<const double>>;
+
+// A stream is either a single scalar or a sequence of spans.
+using Exp = std::generator<Chunk>;
+
+// Stream an existing column without copying it.
+inline Exp column(std::span<const double> col, size_t chunkSize = CHUNK_SIZE) {
+    chunkSize = std::max(chunkSize, size_t{1});
+    for (size_t begin = 0; begin < col.size(); begin += chunkSize) {
+        co_yield Chunk{col.subspan(begin, std::min(chunkSize, col.size() - begin))};
+    }
+}
+
+// Stream a binary file of `double`s without copying it, the spans point
+// into the mapping.
+inline Exp mappedColumn(MappedFile file, size_t chunkSize = CHUNK_SIZE) {
+    file.adviseSequential();
+    const auto col = file.as<double>();
+    chunkSize = std::max(chunkSize, size_t{1});
+    for (size_t begin = 0; begin < col.size(); begin += chunkSize) {
+        co_yield Chunk{col.subspan(begin, std::min(chunkSize, col.size() - begin))};
+    }
+}
+
+// Stream the column `f(0), f(1), ..., f(n - 1)` without materialising it.
+template <typename F>
+Exp generate(size_t n, F f, size_t chunkSize = CHUNK_SIZE) {
+    chunkSize = std::max(chunkSize, size_t{1});
+    std::vector<double> buffer(chunkSize);
+    for (size_t begin = 0; begin < n; begin += chunkSize) {
+        const size_t len = std::min(chunkSize, n - begin);
+        for (size_t i = 0; i < len; ++i) {
+            buffer[i] = f(begin + i);
+        }
+        co_yield Chunk{std::span<const double>{buffer.data(), len}};
+    }
+}
+
+inline Exp scalar(double val) {
+    co_yield Chunk{val};
+}
+
+// Apply `f` chunk by chunk. The chunks of the operands may have different
+// sizes, the result has chunks of at most `chunkSize` elements and ends with
+// the shorter operand.
+template <typename F>
+Exp binaryExpression(Exp exp1, Exp exp2, F f = {}, size_t chunkSize = CHUNK_SIZE) {
+    auto it1 = exp1.begin();
+    auto it2 = exp2.begin();
+    if (it1 == exp1.end() || it2 == exp2.end()) {
+        co_return;
+    }
+    const Chunk first1 = *it1;
+    const Chunk first2 = *it2;
+    const double* scalar1 = std::get_if<double>(&first1);
+    const double* scalar2 = std::get_if<double>(&first2);
+    if (scalar1 && scalar2) {
+        co_yield Chunk{static_cast<double>(f(*scalar1, *scalar2))};
+        co_return;
+    }
+
+    // The part of the current chunk of each operand that is not consumed yet.
+    std::span<const double> rest1 = scalar1 ? std::span<const double>{} : std::get<std::span<const double>>(first1);
+    std::span<const double> rest2 = scalar2 ? std::span<const double>{} : std::get<std::span<const double>>(first2);
+    auto refill = [](auto& it, auto& exp, std::span<const double>& rest) {
+        while (rest.empty()) {
+            if (++it == exp.end()) {
+                return false;
+            }
+            rest = std::get<std::span<const double>>(*it);
+        }
+        return true;
+    };
+
+    chunkSize = std::max(chunkSize, size_t{1});
+    std::vector<double> buffer(chunkSize);
+    while ((scalar1 || refill(it1, exp1, rest1)) && (scalar2 || refill(it2, exp2, rest2))) {
+        size_t len = chunkSize;
+        if (!scalar1) {
+            len = std::min(len, rest1.size());
+        }
+        if (!scalar2) {
+            len = std::min(len, rest2.size());
+        }
+        double* out = buffer.data();
+        if (scalar1) {
+            kernels::evaluate(f, kernels::Scalar{*scalar1}, kernels::Column{rest2.data()}, out, len);
+        } else if (scalar2) {
+            kernels::evaluate(f, kernels::Column{rest1.data()}, kernels::Scalar{*scalar2}, out, len);
+        } else {
+            kernels::evaluate(f, kernels::Column{rest1.data()}, kernels::Column{rest2.data()}, out, len);
+        }
+        if (!scalar1) {
+            rest1 = rest1.subspan(len);
+        }
+        if (!scalar2) {
+            rest2 = rest2.subspan(len);
+        }
+        co_yield Chunk{std::span<const double>{out, len}};
+    }
+}
+
+// Add up all values of a stream.
+inline double sum(Exp exp) {
+    double result = 0;
+    for (const Chunk& chunk : exp) {
+        if (auto val = std::get_if<double>(&chunk)) {
+            result += *val;
+        } else {
+            for (double v : std::get<std::span<const double>>(chunk)) {
+                result += v;
+            }
+        }
+    }
+    return result;
+}
+
+}  // namespace streaming
+
+#endif  // STD_GENERATOR_EXAMPLES_STREAMING_EXPRESSION_H
@@ -0,0 +1,675 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_TASK_H
+#define STD_GENERATOR_EXAMPLES_TASK_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./frame_allocator.h"
+
+// Coroutines that compute a single value, `custom::task<T>`, and a
+// work-stealing scheduler that runs them on a fixed set of threads. A task
+// starts when it is awaited and then runs inline on the thread of the
+// awaiting coroutine, which is resumed by symmetric transfer when the task is
+// done. Parallelism comes from `when_all`, which makes its tasks available to
+// the other threads, and from `task_scheduler::schedule`.
+
+namespace custom {
+
+template<typename T = void>
+class task;
+
+class task_scheduler;
+
+namespace detail {
+// The frames of the tasks of a thread. A frame that is destroyed on another
+// thread than the one that created it moves to the pool of that thread,
+// which is fine because all pools allocate their frames in the same way.
+// The thread that creates the tasks of a `when_all` does not get their
+// frames back if others finish them, so the free lists are capped, otherwise
+// the pools of the finishing threads would grow without bound. The cap still
+// recycles all frames of a fan-out of a few thousand tasks.
+constexpr static size_t TASK_FRAMES_PER_CLASS = 4096;
+
+inline frame_pool &task_frames() {
+  thread_local frame_pool pool{TASK_FRAMES_PER_CLASS};
+  return pool;
+}
+
+// A Chase-Lev deque of coroutines that are ready to run. Only the owning
+// thread pushes and pops at the bottom, any thread may steal from the top.
+// The array grows if it is full, the old arrays are kept until the deque is
+// destroyed because a thief may still read from them.
+class work_deque {
+public:
+  explicit work_deque(size_t capacity = 256) {
+    M_arrays.push_back(std::make_unique<Array>(std::bit_ceil(std::max(capacity, size_t{2}))));
+    M_array.store(M_arrays.back().get(), std::memory_order_relaxed);
+  }
+
+  work_deque(const work_deque &) = delete;
+  work_deque &operator=(const work_deque &) = delete;
+
+  /// Only called by the owner.
+  void push(std::coroutine_handle<> h) {
+    const int64_t b = M_bottom.load(std::memory_order_relaxed);
+    const int64_t t = M_top.load(std::memory_order_acquire);
+    Array *a = M_array.load(std::memory_order_relaxed);
+    if (b - t > static_cast<int64_t>(a->M_mask)) {
+      a = M_grow(a, t, b);
+    }
+    a->M_put(b, h.address());
+    M_bottom.store(b + 1, std::memory_order_release);
+  }
+
+  /// The coroutine that was pushed last, if any. Only called by the owner.
+  std::coroutine_handle<> pop() {
+    const int64_t b = M_bottom.load(std::memory_order_relaxed) - 1;
+    Array *a = M_array.load(std::memory_order_relaxed);
+    M_bottom.store(b, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = M_top.load(std::memory_order_relaxed);
+    if (t > b) {
+      M_bottom.store(b + 1, std::memory_order_release);
+      return {};
+    }
+    void *x = a->M_get(b);
+    if (t == b) {
+      // The last element, race the thieves for it.
+      if (!M_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        x = nullptr;
+      }
+      M_bottom.store(b + 1, std::memory_order_release);
+    }
+    return std::coroutine_handle<>::from_address(x);
+  }
+
+  /// The coroutine that was pushed first, if any and if no other thread
+  /// took it at the same time.
+  std::coroutine_handle<> steal() {
+    int64_t t = M_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = M_bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+      return {};
+    }
+    void *x = M_array.load(std::memory_order_acquire)->M_get(t);
+    if (!M_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return {};
+    }
+    return std::coroutine_handle<>::from_address(x);
+  }
+
+private:
+  struct Array {
+    explicit Array(size_t capacity) : M_mask{capacity - 1}, M_slots{new std::atomic<void *>[capacity]} {}
+
+    void *M_get(int64_t i) const noexcept {
+      return M_slots[static_cast<size_t>(i) & M_mask].load(std::memory_order_relaxed);
+    }
+
+    void M_put(int64_t i, void *x) noexcept {
+      M_slots[static_cast<size_t>(i) & M_mask].store(x, std::memory_order_relaxed);
+    }
+
+    size_t M_mask;
+    std::unique_ptr<std::atomic<void *>[]> M_slots;
+  };
+
+  Array *M_grow(Array *a, int64_t t, int64_t b) {
+    auto bigger = std::make_unique<Array>(2 * (a->M_mask + 1));
+    for (int64_t i = t; i < b; ++i) {
+      bigger->M_put(i, a->M_get(i));
+    }
+    M_arrays.push_back(std::move(bigger));
+    M_array.store(M_arrays.back().get(), std::memory_order_release);
+    return M_arrays.back().get();
+  }
+
+  // The thieves only write `M_top`, the owner mostly `M_bottom`.
+  alignas(64) std::atomic<int64_t> M_top{0};
+  alignas(64) std::atomic<int64_t> M_bottom{0};
+  std::atomic<Array *> M_array{nullptr};
+  std::vector<std::unique_ptr<Array>> M_arrays;
+};
+
+// Counts the tasks of a `when_all` that are not done yet, the last one
+// resumes the awaiting coroutine.
+struct when_all_latch {
+  std::atomic<size_t> M_count{0};
+  std::coroutine_handle<> M_continuation;
+
+  std::coroutine_handle<> M_arrive() noexcept {
+    if (M_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      return M_continuation;
+    }
+    return std::noop_coroutine();
+  }
+};
+
+struct task_promise_base {
+  struct Final_awaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+      auto &p = h.promise();
+      if (p.M_latch) {
+        return p.M_latch->M_arrive();
+      }
+      return p.M_continuation ? p.M_continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+
+  Final_awaiter final_suspend() const noexcept { return {}; }
+
+  void unhandled_exception() noexcept { M_except = std::current_exception(); }
+
+  static void *operator new(std::size_t sz) { return task_frames().allocate(sz, alignof(std::max_align_t)); }
+
+  static void operator delete(void *ptr, std::size_t sz) noexcept {
+    task_frames().deallocate(ptr, sz, alignof(std::max_align_t));
+  }
+
+  // Resumed when the task is done, unless the task belongs to a `when_all`.
+  std::coroutine_handle<> M_continuation;
+  when_all_latch *M_latch = nullptr;
+  std::exception_ptr M_except;
+};
+
+template<typename T>
+struct task_promise : task_promise_base {
+  static_assert(!std::is_reference_v<T>, "A task returns its result by value");
+
+  task<T> get_return_object() noexcept;
+
+  template<typename U = T>
+  requires std::convertible_to<U &&, T>
+  void return_value(U &&value) { M_value.emplace(std::forward<U>(value)); }
+
+  T M_result() {
+    if (M_except) {
+      std::rethrow_exception(M_except);
+    }
+    return std::move(*M_value);
+  }
+
+  std::optional<T> M_value;
+};
+
+template<>
+struct task_promise<void> : task_promise_base {
+  task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+
+  void M_result() const {
+    if (M_except) {
+      std::rethrow_exception(M_except);
+    }
+  }
+};
+
+// Runs a task that has not started yet by symmetric transfer and resumes
+// the awaiting coroutine when it is done.
+struct task_start_awaiter {
+  std::coroutine_handle<> M_coro;
+  task_promise_base *M_promise;
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) const noexcept {
+    M_promise->M_continuation = h;
+    return M_coro;
+  }
+
+  void await_resume() const noexcept {}
+};
+
+struct task_access;
+} // namespace detail
+
+/// Runs coroutines on a fixed set of worker threads. Every worker owns a
+/// deque of ready coroutines: new work of a worker is pushed to and popped
+/// from the bottom of its own deque (so it stays in its cache), and idle
+/// workers steal from the top of the deques of the others, i.e. the oldest
+/// and usually biggest pieces of work. Work from other threads goes through
+/// a shared queue. Idle workers sleep until new work arrives.
+class task_scheduler {
+public:
+  explicit task_scheduler(size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u)) {
+    num_threads = std::max(num_threads, size_t{1});
+    for (size_t i = 0; i < num_threads; ++i) {
+      M_workers.push_back(std::make_unique<Worker>(*this, i));
+    }
+    for (auto &worker: M_workers) {
+      worker->M_thread = std::thread{[this, w = worker.get()] { M_work(*w); }};
+    }
+  }
+
+  task_scheduler(const task_scheduler &) = delete;
+  task_scheduler &operator=(const task_scheduler &) = delete;
+
+  /// All tasks must be done, i.e. every `sync_wait` must have returned.
+  ~task_scheduler() {
+    {
+      std::lock_guard lock{M_mutex};
+      M_stop = true;
+      ++M_epoch;
+    }
+    M_wake.notify_all();
+    // Join all workers before the first deque is destroyed, the others
+    // might still try to steal from it.
+    for (auto &worker: M_workers) {
+      worker->M_thread.join();
+    }
+  }
+
+  /// The scheduler that is used if no other scheduler is configured.
+  static task_scheduler &global() {
+    static task_scheduler scheduler;
+    return scheduler;
+  }
+
+  /// The scheduler of the calling worker thread, `global()` on any other
+  /// thread.
+  static task_scheduler &current() { return M_current ? M_current->M_scheduler : global(); }
+
+  size_t size() const noexcept { return M_workers.size(); }
+
+  /// `co_await scheduler.schedule()` continues on a worker of `scheduler`.
+  auto schedule() noexcept {
+    struct Awaiter {
+      task_scheduler *M_scheduler;
+
+      bool await_ready() const noexcept { return false; }
+
+      void await_suspend(std::coroutine_handle<> h) const { M_scheduler->M_push(h); }
+
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{this};
+  }
+
+  /// Run `t` on this scheduler and block until it is done, returns its
+  /// result or rethrows its exception. Called on a worker of this scheduler
+  /// (e.g. from a generator that is consumed by a task) the worker runs
+  /// other tasks meanwhile, so the scheduler can not run out of threads.
+  template<typename T>
+  T sync_wait(task<T> t);
+
+private:
+  struct Worker {
+    Worker(task_scheduler &scheduler, size_t index) noexcept
+            : M_scheduler{scheduler}, M_random{0x9E3779B97F4A7C15ull * (index + 1)} {}
+
+    // xorshift, to pick the first victim of a steal.
+    size_t M_next_random() noexcept {
+      M_random ^= M_random << 13;
+      M_random ^= M_random >> 7;
+      M_random ^= M_random << 17;
+      return static_cast<size_t>(M_random);
+    }
+
+    task_scheduler &M_scheduler;
+    detail::work_deque M_deque;
+    uint64_t M_random;
+    std::thread M_thread;
+  };
+
+  friend struct detail::task_access;
+
+  // The worker of the calling thread, if any.
+  static inline thread_local Worker *M_current = nullptr;
+
+  bool M_is_own_worker() const noexcept { return M_current && &M_current->M_scheduler == this; }
+
+  // Make `h` available to the workers.
+  void M_push(std::coroutine_handle<> h) {
+    if (M_is_own_worker()) {
+      M_current->M_deque.push(h);
+    } else {
+      std::lock_guard lock{M_mutex};
+      M_injected.push_back(h);
+      M_num_injected.store(M_injected.size(), std::memory_order_relaxed);
+    }
+    // Pairs with the increment of `M_num_sleeping` before the last search
+    // for work of a worker that goes to sleep: either it finds `h` or it is
+    // woken up here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (M_num_sleeping.load(std::memory_order_relaxed) != 0) {
+      {
+        std::lock_guard lock{M_mutex};
+        ++M_epoch;
+      }
+      M_wake.notify_one();
+    }
+  }
+
+  std::coroutine_handle<> M_find_work(Worker &self) {
+    if (auto h = self.M_deque.pop()) {
+      return h;
+    }
+    if (M_num_injected.load(std::memory_order_seq_cst) != 0) {
+      std::lock_guard lock{M_mutex};
+      if (!M_injected.empty()) {
+        auto h = M_injected.front();
+        M_injected.pop_front();
+        M_num_injected.store(M_injected.size(), std::memory_order_relaxed);
+        return h;
+      }
+    }
+    const size_t n = M_workers.size();
+    for (size_t i = 0, start = self.M_next_random() % n; i < n; ++i) {
+      auto &victim = *M_workers[(start + i) % n];
+      if (&victim == &self) {
+        continue;
+      }
+      if (auto h = victim.M_deque.steal()) {
+        return h;
+      }
+    }
+    return {};
+  }
+
+  void M_work(Worker &self) {
+    M_current = &self;
+    while (true) {
+      if (auto h = M_find_work(self)) {
+        h.resume();
+        continue;
+      }
+      size_t epoch;
+      {
+        std::lock_guard lock{M_mutex};
+        if (M_stop) {
+          return;
+        }
+        epoch = M_epoch;
+      }
+      M_num_sleeping.fetch_add(1, std::memory_order_seq_cst);
+      if (auto h = M_find_work(self)) {
+        M_num_sleeping.fetch_sub(1, std::memory_order_relaxed);
+        h.resume();
+        continue;
+      }
+      {
+        std::unique_lock lock{M_mutex};
+        M_wake.wait(lock, [&] { return M_epoch != epoch; });
+      }
+      M_num_sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> M_workers;
+  std::mutex M_mutex;
+  std::condition_variable M_wake;
+  // Guarded by `M_mutex`, changes whenever sleeping workers are woken up.
+  size_t M_epoch = 0;
+  bool M_stop = false;
+  std::deque<std::coroutine_handle<>> M_injected;
+  std::atomic<size_t> M_num_injected{0};
+  std::atomic<size_t> M_num_sleeping{0};
+};
+
+/// A coroutine that computes a `T` (or nothing). It is started by
+/// `co_await`, runs inline on the awaiting thread and resumes the awaiting
+/// coroutine by symmetric transfer when it is done, so awaiting a chain of
+/// tasks neither allocates nor touches the scheduler. Exceptions propagate to
+/// the awaiting coroutine. The frames are recycled by a `frame_pool` per
+/// thread.
+///
+/// In the body of a `custom::generator` or a `batched::generator`,
+/// `co_await` of a task runs it on `task_scheduler::current()` and blocks the
+/// consumer of the generator until it is done, see `blocking_awaiter`.
+template<typename T>
+class [[nodiscard]] task {
+public:
+  using promise_type = detail::task_promise<T>;
+
+  struct blocking_awaiter;
+
+  task(task &&other) noexcept: M_coro{std::exchange(other.M_coro, {})} {}
+
+  task &operator=(task other) noexcept {
+    std::swap(M_coro, other.M_coro);
+    return *this;
+  }
+
+  ~task() {
+    if (M_coro) {
+      M_coro.destroy();
+    }
+  }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter : detail::task_start_awaiter {
+      T await_resume() const { return static_cast<promise_type *>(this->M_promise)->M_result(); }
+    };
+    return Awaiter{{M_coro, &M_coro.promise()}};
+  }
+
+private:
+  friend promise_type;
+  friend struct detail::task_access;
+
+  explicit task(std::coroutine_handle<promise_type> coro) noexcept: M_coro{coro} {}
+
+  std::coroutine_handle<promise_type> M_coro;
+};
+
+/// `co_await` of a task from a generator: the generator is not suspended,
+/// the task runs to completion on the scheduler while the thread waits.
+template<typename T>
+struct task<T>::blocking_awaiter {
+  task M_task;
+
+  bool await_ready() const noexcept { return true; }
+
+  void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+  T await_resume() { return task_scheduler::current().sync_wait(std::move(M_task)); }
+};
+
+namespace detail {
+template<typename T>
+task<T> task_promise<T>::get_return_object() noexcept {
+  return task<T>{std::coroutine_handle<task_promise>::from_promise(*this)};
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept {
+  return task<void>{std::coroutine_handle<task_promise>::from_promise(*this)};
+}
+
+// A task of a `when_all`, without its result type.
+struct task_ref {
+  std::coroutine_handle<> M_coro;
+  task_promise_base *M_promise;
+};
+
+struct task_access {
+  template<typename T>
+  static task_ref M_ref(task<T> &t) noexcept { return {t.M_coro, &t.M_coro.promise()}; }
+
+  template<typename T>
+  static T M_result(task<T> &t) { return t.M_coro.promise().M_result(); }
+
+  static void M_push(std::coroutine_handle<> h) { task_scheduler::current().M_push(h); }
+
+  static task_start_awaiter M_start(task_ref t) noexcept { return {t.M_coro, t.M_promise}; }
+};
+
+// Starts all `tasks` and resumes the awaiting coroutine when the last of
+// them is done. All but the first are pushed to the deque of the current
+// worker, where idle workers can steal them, the first one runs inline.
+struct when_all_awaiter {
+  std::span<const task_ref> M_tasks;
+  when_all_latch &M_latch;
+
+  bool await_ready() const noexcept { return M_tasks.empty(); }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) const {
+    M_latch.M_count.store(M_tasks.size(), std::memory_order_relaxed);
+    M_latch.M_continuation = h;
+    for (const auto &t: M_tasks) {
+      t.M_promise->M_latch = &M_latch;
+    }
+    // Pushed in reverse, so that the owner pops them in order.
+    for (size_t i = M_tasks.size(); i-- > 1;) {
+      task_access::M_push(M_tasks[i].M_coro);
+    }
+    return M_tasks.front().M_coro;
+  }
+
+  void await_resume() const noexcept {}
+};
+
+// The coroutine of `sync_wait`, which signals the waiting thread when it is
+// done.
+struct sync_wait_state {
+  std::mutex M_mutex;
+  std::condition_variable M_done_changed;
+  std::atomic<bool> M_done{false};
+
+  void M_signal() {
+    // Under the lock, the waiter destroys this state as soon as it sees
+    // `M_done`.
+    std::lock_guard lock{M_mutex};
+    M_done.store(true, std::memory_order_release);
+    M_done_changed.notify_all();
+  }
+};
+
+struct sync_wait_task {
+  struct promise_type {
+    sync_wait_state *M_state = nullptr;
+
+    sync_wait_task get_return_object() noexcept {
+      return sync_wait_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    auto final_suspend() const noexcept {
+      struct Awaiter {
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<promise_type> h) const noexcept { h.promise().M_state->M_signal(); }
+
+        void await_resume() const noexcept {}
+      };
+      return Awaiter{};
+    }
+
+    void return_void() const noexcept {}
+
+    // The exceptions of the task are stored in its own promise.
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+
+  explicit sync_wait_task(std::coroutine_handle<promise_type> coro) noexcept: M_coro{coro} {}
+
+  sync_wait_task(sync_wait_task &&) = delete;
+
+  ~sync_wait_task() { M_coro.destroy(); }
+
+  std::coroutine_handle<promise_type> M_coro;
+};
+
+inline sync_wait_task sync_wait_body(task_scheduler &scheduler, task_ref t) {
+  co_await scheduler.schedule();
+  co_await task_access::M_start(t);
+}
+} // namespace detail
+
+template<typename T>
+T task_scheduler::sync_wait(task<T> t) {
+  detail::sync_wait_state state;
+  detail::sync_wait_task waiter = detail::sync_wait_body(*this, detail::task_access::M_ref(t));
+  waiter.M_coro.promise().M_state = &state;
+  waiter.M_coro.resume();
+  if (M_is_own_worker()) {
+    while (!state.M_done.load(std::memory_order_acquire)) {
+      if (auto h = M_find_work(*M_current)) {
+        h.resume();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    // Wait until `M_signal` has released the lock.
+    std::lock_guard lock{state.M_mutex};
+  } else {
+    std::unique_lock lock{state.M_mutex};
+    state.M_done_changed.wait(lock, [&] { return state.M_done.load(std::memory_order_acquire); });
+  }
+  return detail::task_access::M_result(t);
+}
+
+/// The results of all `tasks`, which may run in parallel: all but the first
+/// are pushed to the deque of the current worker, from where other workers
+/// can steal them. The first one runs inline. The awaiting coroutine is
+/// resumed by the task that finishes last, on its thread. If tasks throw,
+/// the exception of the first of them (in argument order) is rethrown.
+template<typename... Ts>
+task<std::tuple<Ts...>>
+when_all(task<Ts>... tasks) {
+  static_assert((!std::is_void_v<Ts> && ...), "Use the overload for a vector of `task<void>`");
+  const std::array<detail::task_ref, sizeof...(Ts)> refs{detail::task_access::M_ref(tasks)...};
+  detail::when_all_latch latch;
+  co_await detail::when_all_awaiter{refs, latch};
+  co_return std::tuple<Ts...>{detail::task_access::M_result(tasks)...};
+}
+
+/// The same for any number of tasks of the same type, the results are in
+/// the order of `tasks`.
+template<typename T>
+task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>>
+when_all(std::vector<task<T>> tasks) {
+  std::vector<detail::task_ref> refs;
+  refs.reserve(tasks.size());
+  for (auto &t: tasks) {
+    refs.push_back(detail::task_access::M_ref(t));
+  }
+  detail::when_all_latch latch;
+  co_await detail::when_all_awaiter{refs, latch};
+  if constexpr (std::is_void_v<T>) {
+    for (auto &t: tasks) {
+      detail::task_access::M_result(t);
+    }
+  } else {
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for (auto &t: tasks) {
+      results.push_back(detail::task_access::M_result(t));
+    }
+    co_return results;
+  }
+}
+
+} // namespace custom
+
+#endif //STD_GENERATOR_EXAMPLES_TASK_H
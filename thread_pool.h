@@ -0,0 +1,162 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_THREAD_POOL_H
+#define STD_GENERATOR_EXAMPLES_THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that is reused for all parallel loops, so
+// that a loop only pays for waking up the workers, not for creating them.
+class ThreadPool {
+public:
+    // `numThreads` includes the thread that calls `parallelFor`, which
+    // always takes part in the work.
+    explicit ThreadPool(size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u)) {
+        for (size_t i = 1; i < numThreads; ++i) {
+            workers_.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        for (auto& worker : workers_) {
+            worker.request_stop();
+        }
+        {
+            std::lock_guard lock{mutex_};
+        }
+        wakeUp_.notify_all();
+    }
+
+    // The pool that is used if no other pool is configured.
+    static ThreadPool& global() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const { return workers_.size() + 1; }
+
+    // Run `task` on one of the workers and return immediately, or run it on
+    // the calling thread if the pool has no workers.
+    void submit(std::function<void()> task) {
+        if (workers_.empty()) {
+            task();
+            return;
+        }
+        {
+            std::lock_guard lock{mutex_};
+            tasks_.push_back(std::move(task));
+        }
+        wakeUp_.notify_one();
+    }
+
+    // Call `f(begin, end)` for consecutive ranges that cover `[0, n)` and
+    // return when all calls are finished. Every range but the last has a
+    // multiple of `alignment` elements and there are at most a few ranges per
+    // thread, so that the threads that finish early can help the others.
+    // Runs on the calling thread only if called from a worker of any pool.
+    template <typename F>
+    void parallelFor(size_t n, size_t alignment, F f) {
+        constexpr size_t CHUNKS_PER_THREAD = 4;
+        const size_t numChunks = std::clamp(n / std::max(alignment, size_t{1}), size_t{1}, size() * CHUNKS_PER_THREAD);
+        if (numChunks == 1 || insideWorker()) {
+            f(size_t{0}, n);
+            return;
+        }
+        const size_t chunkSize = (n / numChunks + alignment - 1) / alignment * alignment;
+
+        struct Loop {
+            std::atomic<size_t> next{0};
+            // Guards `except` and `numRunning`.
+            std::mutex mutex;
+            std::condition_variable finished;
+            std::exception_ptr except;
+            size_t numRunning = 0;
+        } loop;
+        auto run = [&loop, &f, n, chunkSize]() {
+            try {
+                size_t begin;
+                while ((begin = loop.next.fetch_add(chunkSize, std::memory_order_relaxed)) < n) {
+                    f(begin, std::min(begin + chunkSize, n));
+                }
+            } catch (...) {
+                std::lock_guard lock{loop.mutex};
+                if (!loop.except) {
+                    loop.except = std::current_exception();
+                }
+                loop.next.store(n, std::memory_order_relaxed);
+            }
+        };
+
+        // The helpers may start after the loop is finished, but this call
+        // must not return before the last one of them has left `run`.
+        const size_t numHelpers = std::min(workers_.size(), (n + chunkSize - 1) / chunkSize - 1);
+        loop.numRunning = numHelpers + 1;
+        auto helper = [&loop, &run]() {
+            run();
+            // Notified under the lock, `loop` is destroyed as soon as the
+            // caller sees that no helper is running anymore.
+            std::lock_guard lock{loop.mutex};
+            if (--loop.numRunning == 0) {
+                loop.finished.notify_one();
+            }
+        };
+        {
+            std::lock_guard lock{mutex_};
+            for (size_t i = 0; i < numHelpers; ++i) {
+                tasks_.emplace_back(helper);
+            }
+        }
+        wakeUp_.notify_all();
+        helper();
+        std::unique_lock lock{loop.mutex};
+        loop.finished.wait(lock, [&loop] { return loop.numRunning == 0; });
+        if (loop.except) {
+            std::rethrow_exception(loop.except);
+        }
+    }
+
+private:
+    static bool& insideWorker() {
+        thread_local bool inside = false;
+        return inside;
+    }
+
+    void work(std::stop_token stop) {
+        insideWorker() = true;
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock{mutex_};
+                wakeUp_.wait(lock, [&] { return stop.stop_requested() || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    std::deque<std::function<void()>> tasks_;
+    // Declared last, so that the workers are joined before the queue is gone.
+    std::vector<std::jthread> workers_;
+};
+
+#endif //STD_GENERATOR_EXAMPLES_THREAD_POOL_H
@@ -0,0 +1,260 @@
+//
+// Created by kalmbacj on 10/17/26.
+//
+
+#ifndef STD_GENERATOR_EXAMPLES_TYPED_EXPRESSION_H
+#define STD_GENERATOR_EXAMPLES_TYPED_EXPRESSION_H
+
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <generator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "./binary_expression.h"
+
+// Binary expressions over typed columns. In contrast to `::Arg`, which is
+// always `double`, the element type is kept, so that `float` and `int32_t`
+// columns need half of the memory bandwidth of `double` columns and integers
+// are not converted back and forth. Comparisons produce packed bitmasks.
+namespace typed {
+
+// A column of `bool`s with one bit per element. The bits past `size()` are
+// always zero.
+class Bitmask {
+public:
+    static constexpr size_t BITS = 64;
+
+    Bitmask() = default;
+    explicit Bitmask(size_t size) : words_((size + BITS - 1) / BITS), size_{size} {}
+
+    size_t size() const { return size_; }
+    bool operator[](size_t i) const { return (words_[i / BITS] >> (i % BITS)) & 1; }
+
+    // The number of elements that are true.
+    size_t count() const {
+        size_t result = 0;
+        for (uint64_t word : words_) {
+            result += std::popcount(word);
+        }
+        return result;
+    }
+
+    uint64_t* words() { return words_.data(); }
+    const uint64_t* words() const { return words_.data(); }
+    size_t numWords() const { return words_.size(); }
+
+    // Reset the bits past `size()` after a word-wise operation.
+    void clearTail() {
+        if (size_ % BITS != 0) {
+            words_.back() &= (uint64_t{1} << (size_ % BITS)) - 1;
+        }
+    }
+
+private:
+    std::vector<uint64_t> words_;
+    size_t size_ = 0;
+};
+
+// A scalar or a column of one of the supported element types.
+using Arg = std::variant<float, double, int32_t, int64_t, bool, std::vector<float>, std::vector<double>,
+                         std::vector<int32_t>, std::vector<int64_t>, Bitmask>;
+
+using Exp = std::generator<Arg>;
+
+namespace detail {
+template <typename T>
+struct Element {
+    using type = T;
+    static constexpr bool isScalar = true;
+};
+
+template <typename T>
+struct Element<std::vector<T>> {
+    using type = T;
+    static constexpr bool isScalar = false;
+};
+
+template <>
+struct Element<Bitmask> {
+    using type = bool;
+    static constexpr bool isScalar = false;
+};
+
+template <typename A>
+using ElementType = typename Element<A>::type;
+
+template <typename F>
+constexpr bool isComparison =
+        std::same_as<F, std::less<>> || std::same_as<F, std::less_equal<>> || std::same_as<F, std::greater<>> ||
+        std::same_as<F, std::greater_equal<>> || std::same_as<F, std::equal_to<>> || std::same_as<F, std::not_equal_to<>>;
+
+// The word-wise operation on bitmasks that corresponds to `F`.
+template <typename F>
+struct WordOp {};
+template <>
+struct WordOp<std::bit_and<>> : std::bit_and<> {};
+template <>
+struct WordOp<std::logical_and<>> : std::bit_and<> {};
+template <>
+struct WordOp<std::bit_or<>> : std::bit_or<> {};
+template <>
+struct WordOp<std::logical_or<>> : std::bit_or<> {};
+template <>
+struct WordOp<std::bit_xor<>> : std::bit_xor<> {};
+template <>
+struct WordOp<std::not_equal_to<>> : std::bit_xor<> {};
+
+template <typename F>
+constexpr bool isLogical = std::is_base_of_v<std::bit_and<>, WordOp<F>> ||
+                           std::is_base_of_v<std::bit_or<>, WordOp<F>> ||
+                           std::is_base_of_v<std::bit_xor<>, WordOp<F>>;
+
+inline size_t size(const auto& arg) {
+    if constexpr (Element<std::remove_cvref_t<decltype(arg)>>::isScalar) {
+        return 1;
+    } else {
+        return arg.size();
+    }
+}
+
+template <typename A>
+auto operand(const A& a) {
+    if constexpr (Element<A>::isScalar) {
+        return kernels::Scalar<A>{a};
+    } else {
+        return kernels::Column<ElementType<A>>{a.data()};
+    }
+}
+
+// `kernels::compare`, split across threads for large results like
+// `evaluateKernel`. The chunks are whole words of the bitmask.
+template <typename C, typename F, typename A, typename B>
+void compareKernel(F f, A a, B b, uint64_t* out, size_t n) {
+    const auto& config = parallelConfig();
+    if (n < config.threshold) {
+        kernels::compare<C>(f, a, b, out, n);
+        return;
+    }
+    auto& pool = config.pool ? *config.pool : ThreadPool::global();
+    constexpr size_t ALIGNMENT = Bitmask::BITS * 64;
+    pool.parallelFor(n, ALIGNMENT, [&](size_t begin, size_t end) {
+        kernels::compare<C>(f, kernels::advance(a, begin), kernels::advance(b, begin), out + begin / Bitmask::BITS,
+                            end - begin);
+    });
+}
+
+// `f` applied word by word to two bitmasks, or to a bitmask and a `bool`.
+template <typename F, typename A, typename B>
+Arg evaluateLogical(F, const A& a, const B& b, size_t resultSize) {
+    WordOp<F> op;
+    if constexpr (Element<A>::isScalar && Element<B>::isScalar) {
+        return Arg{static_cast<bool>(op(a, b))};
+    } else {
+        auto word = [](const auto& x, size_t i) -> uint64_t {
+            if constexpr (std::same_as<std::remove_cvref_t<decltype(x)>, bool>) {
+                return x ? ~uint64_t{0} : 0;
+            } else {
+                return x.words()[i];
+            }
+        };
+        Bitmask res(resultSize);
+        for (size_t i = 0; i < res.numWords(); ++i) {
+            res.words()[i] = op(word(a, i), word(b, i));
+        }
+        res.clearTail();
+        return res;
+    }
+}
+
+template <typename F, typename A, typename B>
+Arg evaluate(F f, const A& a, const B& b, size_t resultSize) {
+    using TA = ElementType<A>;
+    using TB = ElementType<B>;
+    constexpr bool scalars = Element<A>::isScalar && Element<B>::isScalar;
+    if constexpr (std::same_as<TA, bool> || std::same_as<TB, bool>) {
+        if constexpr (std::same_as<TA, TB> && isLogical<F>) {
+            return evaluateLogical(f, a, b, resultSize);
+        } else {
+            throw std::invalid_argument{"This operation is not defined for bitmasks"};
+        }
+    } else if constexpr (isComparison<F>) {
+        using C = std::common_type_t<TA, TB>;
+        if constexpr (scalars) {
+            return Arg{static_cast<bool>(f(static_cast<C>(a), static_cast<C>(b)))};
+        } else {
+            Bitmask res(resultSize);
+            compareKernel<C>(f, operand(a), operand(b), res.words(), resultSize);
+            if (resultSize == 1) {
+                return Arg{res[0]};
+            }
+            return res;
+        }
+    } else {
+        using R = std::common_type_t<TA, TB>;
+        if constexpr (!std::invocable<F, R, R>) {
+            throw std::invalid_argument{"This operation is not defined for the types of the operands"};
+        } else if constexpr (scalars) {
+            return Arg{static_cast<R>(f(static_cast<R>(a), static_cast<R>(b)))};
+        } else {
+            std::vector<R> res(resultSize);
+            evaluateKernel(f, operand(a), operand(b), res.data(), resultSize);
+            if (resultSize == 1) {
+                return Arg{res.front()};
+            }
+            return res;
+        }
+    }
+}
+}  // namespace detail
+
+// The size of the result of a binary operation, with the same broadcasting
+// rules as `::getResultSize`.
+inline size_t getResultSize(const Arg& arg1, const Arg& arg2) {
+    auto getSingleSize = [](const auto& arg) { return detail::size(arg); };
+    const size_t size1 = std::visit(getSingleSize, arg1);
+    const size_t size2 = std::visit(getSingleSize, arg2);
+    auto isScalar = [](const Arg& arg) {
+        return std::visit([]<typename T>(const T&) { return detail::Element<T>::isScalar; }, arg);
+    };
+    if (isScalar(arg1)) {
+        return size2;
+    }
+    if (isScalar(arg2)) {
+        return size1;
+    }
+    if (size1 != size2) {
+        throw std::invalid_argument{"Operands of a binary expression have different sizes " + std::to_string(size1) +
+                                    " and " + std::to_string(size2)};
+    }
+    return size1;
+}
+
+// Apply `f` with the usual arithmetic conversions, e.g. `int32_t` and
+// `float` give `float`, and `int32_t` and `int64_t` give `int64_t`. The
+// comparisons `std::less<>` etc. give a `Bitmask` (or a `bool`), and
+// `std::bit_and<>`, `std::bit_or<>` etc. combine bitmasks. An operation
+// that is not defined for the types, e.g. any other operation on a bitmask,
+// throws `std::invalid_argument`.
+// The code for each pair of types is generated at compile time.
+template <typename F>
+Arg evaluateBinaryExpression(const Arg& arg1, const Arg& arg2, F f) {
+    const size_t resultSize = getResultSize(arg1, arg2);
+    auto impl = [f, resultSize](const auto& a, const auto& b) { return detail::evaluate(f, a, b, resultSize); };
+    return std::visit(impl, arg1, arg2);
+}
+
+template <typename F>
+Exp binaryExpression(Exp exp1, Exp exp2, F f = {}) {
+    for (const auto& [arg1, arg2] : std::views::zip(std::move(exp1), std::move(exp2))) {
+        co_yield evaluateBinaryExpression(arg1, arg2, f);
+    }
+}
+
+}  // namespace typed
+
+#endif //STD_GENERATOR_EXAMPLES_TYPED_EXPRESSION_H